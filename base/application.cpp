@@ -6,10 +6,19 @@ namespace vk_sandbox {
         spdlog::error("[GLFW] error: {} ", description);
     }
 
-    Application::Application(const std::string& title) : title(title) {}
+    Application::Application(const std::string& title, bool headless) : title(title), headless(headless) {}
 
     void Application::init() {
 
+        if (headless) {
+            VulkanContextSettings settings{};
+            settings.headless = true;
+            context.init_vulkan(settings);
+            context.create_headless({800, 600});
+            loop();
+            return;
+        }
+
         if (!glfwInit()) {
             spdlog::error("Error on initialize GLFW");
             return;
@@ -32,19 +41,65 @@ namespace vk_sandbox {
         context.create_swapchain(window, true);
     }
 
+    bool Application::should_close() {
+        if (headless) {
+            return closing;
+        }
+        return closing || glfwWindowShouldClose(window);
+    }
+
+    void Application::close() {
+        closing = true;
+    }
+
     void Application::loop() {
-        while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+        frame_stats.init();
+        uint64_t frame_begin = CpuProfiler::now();
 
-            glm::ivec2 framebuffer_size{};
-            glfwGetFramebufferSize(window, &framebuffer_size.x, &framebuffer_size.y);
+        while (!should_close()) {
+            CpuZone frame_zone("frame");
+            glm::ivec2 framebuffer_size = context.get_extent();
 
-            if (context.begin_frame(framebuffer_size)) {
-                this->draw();
+            if (!headless) {
+                CpuZone zone("poll_events");
+                glfwPollEvents();
+                glfwGetFramebufferSize(window, &framebuffer_size.x, &framebuffer_size.y);
+            }
+
+            bool began;
+            {
+                CpuZone zone("begin_frame");
+                began = context.begin_frame(framebuffer_size);
+            }
+            if (began) {
+                {
+                    CpuZone zone("draw");
+                    this->draw();
+                }
+                CpuZone zone("end_frame");
                 context.end_frame();
             }
+
+            //frame to frame, so the sample includes everything the loop blocked on.
+            uint64_t frame_end = CpuProfiler::now();
+            frame_stats.add_sample(FrameMetric::cpu_frame, (frame_end - frame_begin) / 1e6);
+            frame_begin = frame_end;
+            if (began) {
+                frame_stats.add_sample(FrameMetric::fence_wait, context.get_fence_wait_milliseconds());
+                double gpu_frame = context.get_gpu_milliseconds("frame");
+                if (gpu_frame > 0.0) {
+                    frame_stats.add_sample(FrameMetric::gpu_frame, gpu_frame);
+                }
+                if (!headless) {
+                    frame_stats.add_sample(FrameMetric::present, context.get_present_milliseconds());
+                }
+            }
+            frame_stats.end_frame();
+        }
+
+        if (!headless) {
+            glfwTerminate();
         }
-        glfwTerminate();
     }
 
     void Application::destroy() {
@@ -7,25 +7,36 @@
 #define VK_NO_PROTOTYPES
 #include <GLFW/glfw3.h>
 #include "vulkan_context.hpp"
+#include "cpu_profiler.hpp"
+#include "frame_stats.hpp"
 
 namespace vk_sandbox {
 
     class Application {
     public:
-        Application(const std::string& title);
+        Application(const std::string& title, bool headless = false);
 
         virtual void draw() = 0;
 
         void init();
         void destroy();
+        void close();
+
+        const FrameStats& get_frame_stats() const { return frame_stats; }
+    protected:
+        VulkanContext& get_context() { return context; }
     private:
-        GLFWwindow *window;
+        GLFWwindow *window{};
         VulkanContext context;
+        FrameStats frame_stats{};
 
         std::string title;
+        bool headless{false};
+        bool closing{false};
 
         void create_window();
 
+        bool should_close();
         void loop();
     };
 
@@ -0,0 +1,187 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include "bindless_table.hpp"
+
+namespace vk_sandbox {
+
+    uint32_t BindlessTable::SlotAllocator::allocate(uint32_t capacity) {
+        if (!free_slots.empty()) {
+            uint32_t slot = free_slots.back();
+            free_slots.pop_back();
+            return slot;
+        }
+        if (next < capacity) {
+            return next++;
+        }
+        return INVALID_BINDLESS_HANDLE;
+    }
+
+    void BindlessTable::SlotAllocator::recycle(uint64_t frame_number, size_t frames_in_flight) {
+        while (!retired_slots.empty() && frame_number >= retired_slots.front().first + frames_in_flight) {
+            free_slots.push_back(retired_slots.front().second);
+            retired_slots.pop_front();
+        }
+    }
+
+    static uint32_t clamp_capacity(VkPhysicalDevice physical_device, uint32_t capacity) {
+        VkPhysicalDeviceDescriptorIndexingProperties indexing_properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES};
+        VkPhysicalDeviceProperties2 properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+        properties.pNext = &indexing_properties;
+        vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+        //both bindings are visible to every stage, combined image samplers count as a sampler and a sampled image.
+        uint32_t max_capacity = std::min({
+                indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                indexing_properties.maxPerStageUpdateAfterBindResources / 2,
+                indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+                indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers
+        });
+        if (capacity > max_capacity) {
+            spdlog::warn("[BindlessTable] {} slots requested, the device allows {}", capacity, max_capacity);
+            return max_capacity;
+        }
+        return capacity;
+    }
+
+    bool BindlessTable::init(VkPhysicalDevice physical_device, VkDevice device, uint32_t capacity) {
+        this->device = device;
+        this->capacity = capacity = clamp_capacity(physical_device, capacity);
+        spdlog::info("[BindlessTable] {} texture and {} buffer slots", capacity, capacity);
+
+        VkDescriptorSetLayoutBinding bindings[2]{};
+        bindings[0].binding = TEXTURE_BINDING;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = capacity;
+        bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+        bindings[1].binding = BUFFER_BINDING;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[1].descriptorCount = capacity;
+        bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+        //slots may be written while the set is bound by frames in flight, as long as those frames never index them.
+        VkDescriptorBindingFlags binding_flags[2] = {
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+        };
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO};
+        binding_flags_info.bindingCount = 2;
+        binding_flags_info.pBindingFlags = binding_flags;
+
+        VkDescriptorSetLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+        layout_info.pNext = &binding_flags_info;
+        layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layout_info.bindingCount = 2;
+        layout_info.pBindings = bindings;
+
+        if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &layout) != VK_SUCCESS) {
+            spdlog::error("[BindlessTable] failed to create bindless descriptor set layout with {} slots", capacity);
+            return false;
+        }
+
+        VkDescriptorPoolSize sizes[] = {
+                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity},
+                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         capacity}
+        };
+
+        VkDescriptorPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        pool_info.maxSets = 1;
+        pool_info.poolSizeCount = 2;
+        pool_info.pPoolSizes = sizes;
+
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &pool) != VK_SUCCESS) {
+            spdlog::error("[BindlessTable] failed to create bindless descriptor pool with {} slots", capacity);
+            return false;
+        }
+
+        VkDescriptorSetAllocateInfo alloc_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        alloc_info.descriptorPool = pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &layout;
+
+        if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor_set) != VK_SUCCESS) {
+            spdlog::error("[BindlessTable] failed to allocate bindless descriptor set with {} slots", capacity);
+            return false;
+        }
+        return true;
+    }
+
+    void BindlessTable::destroy() {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+        pool = VK_NULL_HANDLE;
+        layout = VK_NULL_HANDLE;
+        descriptor_set = VK_NULL_HANDLE;
+    }
+
+    uint32_t BindlessTable::add_texture(VkImageView image_view, VkSampler sampler, VkImageLayout image_layout) {
+        uint32_t handle = textures.allocate(capacity);
+        if (handle == INVALID_BINDLESS_HANDLE) {
+            spdlog::error("[BindlessTable] texture table is full ({} slots)", capacity);
+            return handle;
+        }
+
+        VkDescriptorImageInfo image_info{};
+        image_info.imageView = image_view;
+        image_info.sampler = sampler;
+        image_info.imageLayout = image_layout;
+
+        VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        write.dstSet = descriptor_set;
+        write.dstBinding = TEXTURE_BINDING;
+        write.dstArrayElement = handle;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &image_info;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+        return handle;
+    }
+
+    uint32_t BindlessTable::add_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+        uint32_t handle = buffers.allocate(capacity);
+        if (handle == INVALID_BINDLESS_HANDLE) {
+            spdlog::error("[BindlessTable] buffer table is full ({} slots)", capacity);
+            return handle;
+        }
+
+        VkDescriptorBufferInfo buffer_info{};
+        buffer_info.buffer = buffer;
+        buffer_info.offset = offset;
+        buffer_info.range = range;
+
+        VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        write.dstSet = descriptor_set;
+        write.dstBinding = BUFFER_BINDING;
+        write.dstArrayElement = handle;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &buffer_info;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+        return handle;
+    }
+
+    void BindlessTable::release_texture(uint32_t handle, uint64_t frame_number) {
+        if (handle != INVALID_BINDLESS_HANDLE) {
+            textures.retired_slots.emplace_back(frame_number, handle);
+        }
+    }
+
+    void BindlessTable::release_buffer(uint32_t handle, uint64_t frame_number) {
+        if (handle != INVALID_BINDLESS_HANDLE) {
+            buffers.retired_slots.emplace_back(frame_number, handle);
+        }
+    }
+
+    void BindlessTable::recycle(uint64_t frame_number, size_t frames_in_flight) {
+        textures.recycle(frame_number, frames_in_flight);
+        buffers.recycle(frame_number, frames_in_flight);
+    }
+
+}
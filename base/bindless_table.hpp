@@ -0,0 +1,53 @@
+#pragma once
+
+#include "volk.h"
+#include <vector>
+#include <deque>
+
+namespace vk_sandbox {
+
+    const uint32_t INVALID_BINDLESS_HANDLE = UINT32_MAX;
+
+    //one global update-after-bind descriptor set holding every texture and storage buffer,
+    //shaders index it with the integer handle returned when a resource is added.
+    class BindlessTable {
+    public:
+        static const uint32_t TEXTURE_BINDING = 0;
+        static const uint32_t BUFFER_BINDING = 1;
+
+        //capacity is clamped to the update-after-bind limits of the physical device.
+        bool init(VkPhysicalDevice physical_device, VkDevice device, uint32_t capacity);
+        void destroy();
+
+        uint32_t add_texture(VkImageView image_view, VkSampler sampler, VkImageLayout image_layout);
+        uint32_t add_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+        //slots are reused only once frames recorded up to frame_number can no longer index them.
+        void release_texture(uint32_t handle, uint64_t frame_number);
+        void release_buffer(uint32_t handle, uint64_t frame_number);
+        void recycle(uint64_t frame_number, size_t frames_in_flight);
+
+        VkDescriptorSetLayout get_layout() const { return layout; }
+        VkDescriptorSet get_set() const { return descriptor_set; }
+        uint32_t get_capacity() const { return capacity; }
+    private:
+        struct SlotAllocator {
+            uint32_t next{};
+            std::vector<uint32_t> free_slots;
+            std::deque<std::pair<uint64_t, uint32_t>> retired_slots;
+
+            uint32_t allocate(uint32_t capacity);
+            void recycle(uint64_t frame_number, size_t frames_in_flight);
+        };
+
+        VkDevice device{};
+        uint32_t capacity{};
+        VkDescriptorSetLayout layout{};
+        VkDescriptorPool pool{};
+        VkDescriptorSet descriptor_set{};
+
+        SlotAllocator textures{};
+        SlotAllocator buffers{};
+    };
+
+}
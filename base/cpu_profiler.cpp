@@ -0,0 +1,113 @@
+#include "cpu_profiler.hpp"
+#include <spdlog/spdlog.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vk_sandbox {
+
+    struct CpuZoneEvent {
+        const char* name{};
+        uint64_t begin{};
+        uint64_t end{};
+    };
+
+    struct CpuThreadRing {
+        uint32_t thread_id{};
+        std::vector<CpuZoneEvent> events;
+        //total events written, the ring holds the last CPU_ZONE_RING_SIZE of them
+        std::atomic<uint64_t> head{0};
+    };
+
+    //rings are owned here rather than by their thread so zones of finished threads still export.
+    struct CpuProfilerRegistry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<CpuThreadRing>> rings;
+        std::atomic<bool> enabled{true};
+        std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+    };
+
+    static CpuProfilerRegistry& get_registry() {
+        static CpuProfilerRegistry registry;
+        return registry;
+    }
+
+    static CpuThreadRing& get_thread_ring() {
+        thread_local CpuThreadRing* ring = nullptr;
+        if (ring == nullptr) {
+            CpuProfilerRegistry& registry = get_registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.rings.push_back(std::make_unique<CpuThreadRing>());
+            ring = registry.rings.back().get();
+            ring->thread_id = registry.rings.size() - 1;
+            ring->events.resize(CPU_ZONE_RING_SIZE);
+        }
+        return *ring;
+    }
+
+    void CpuProfiler::set_enabled(bool enabled) {
+        get_registry().enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool CpuProfiler::is_enabled() {
+        return get_registry().enabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t CpuProfiler::now() {
+        auto elapsed = std::chrono::steady_clock::now() - get_registry().epoch;
+        //never 0, CpuZone uses it for "not recording"
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() + 1;
+    }
+
+    void CpuProfiler::record(const char* name, uint64_t begin, uint64_t end) {
+        CpuThreadRing& ring = get_thread_ring();
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        ring.events[head % CPU_ZONE_RING_SIZE] = {name, begin, end};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    bool CpuProfiler::write_chrome_trace(const std::string& path) {
+        std::ofstream file(path);
+        if (!file) {
+            spdlog::error("[CpuProfiler] failed to open {} for writing", path);
+            return false;
+        }
+
+        CpuProfilerRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        //complete events in microseconds, the viewer nests them by time per thread.
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        size_t event_count = 0;
+        for (auto& ring : registry.rings) {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t start = head > CPU_ZONE_RING_SIZE ? head - CPU_ZONE_RING_SIZE : 0;
+            for (uint64_t i = start; i < head; ++i) {
+                const CpuZoneEvent& event = ring->events[i % CPU_ZONE_RING_SIZE];
+                file << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->thread_id
+                     << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+                first = false;
+            }
+            event_count += head - start;
+        }
+        file << "\n]}\n";
+
+        spdlog::info("[CpuProfiler] wrote {} zones of {} threads to {}", event_count, registry.rings.size(), path);
+        return static_cast<bool>(file);
+    }
+
+    void CpuProfiler::clear() {
+        CpuProfilerRegistry& registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto& ring : registry.rings) {
+            ring->head.store(0, std::memory_order_relaxed);
+        }
+    }
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace vk_sandbox {
+
+    //events kept per thread, older ones are overwritten
+    const uint32_t CPU_ZONE_RING_SIZE = 16384;
+
+    //scoped CPU timing. Every thread records into its own ring, only its first zone takes a lock to register it.
+    //Zone names are stored by pointer and have to outlive the profiler, string literals in practice.
+    class CpuProfiler {
+    public:
+        static void set_enabled(bool enabled);
+        static bool is_enabled();
+
+        //nanoseconds since the profiler's epoch
+        static uint64_t now();
+        static void record(const char* name, uint64_t begin, uint64_t end);
+
+        //read the rings while no zone is being recorded, after the loop or between frames.
+        static bool write_chrome_trace(const std::string& path);
+        static void clear();
+    };
+
+    class CpuZone {
+    public:
+        explicit CpuZone(const char* name) : name(name), begin(CpuProfiler::is_enabled() ? CpuProfiler::now() : 0) {}
+        ~CpuZone() {
+            if (begin != 0) {
+                CpuProfiler::record(name, begin, CpuProfiler::now());
+            }
+        }
+
+        CpuZone(const CpuZone&) = delete;
+        CpuZone& operator=(const CpuZone&) = delete;
+    private:
+        const char* name;
+        uint64_t begin;
+    };
+
+}
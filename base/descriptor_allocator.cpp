@@ -0,0 +1,162 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include "descriptor_allocator.hpp"
+
+namespace vk_sandbox {
+
+    //descriptors of each type reserved per set in a pool.
+    struct PoolSizeRatio {
+        VkDescriptorType type;
+        float ratio;
+    };
+
+    const PoolSizeRatio POOL_SIZE_RATIOS[] = {
+            {VK_DESCRIPTOR_TYPE_SAMPLER,                0.5f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f},
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          4.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          1.f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         2.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         2.f},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.f},
+            {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,       0.5f}
+    };
+
+    void DescriptorAllocator::init(VkDevice device, uint32_t sets_per_pool, VkDescriptorPoolCreateFlags flags) {
+        this->device = device;
+        this->sets_per_pool = sets_per_pool;
+        this->flags = flags;
+    }
+
+    void DescriptorAllocator::destroy() {
+        for (auto pool : used_pools) {
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        }
+        for (auto pool : free_pools) {
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        }
+        used_pools.clear();
+        free_pools.clear();
+        live_sets.clear();
+        reclaimable_pools.clear();
+        current_pool = VK_NULL_HANDLE;
+    }
+
+    VkDescriptorPool DescriptorAllocator::grab_pool() {
+        if (!free_pools.empty()) {
+            VkDescriptorPool pool = free_pools.back();
+            free_pools.pop_back();
+            return pool;
+        }
+
+        std::vector<VkDescriptorPoolSize> sizes;
+        for (auto& pool_size_ratio : POOL_SIZE_RATIOS) {
+            sizes.push_back({pool_size_ratio.type, static_cast<uint32_t>(pool_size_ratio.ratio * sets_per_pool)});
+        }
+
+        VkDescriptorPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        pool_info.flags = flags;
+        pool_info.maxSets = sets_per_pool;
+        pool_info.poolSizeCount = sizes.size();
+        pool_info.pPoolSizes = sizes.data();
+
+        VkDescriptorPool pool{};
+        if (vkCreateDescriptorPool(device, &pool_info, nullptr, &pool) != VK_SUCCESS) {
+            spdlog::error("[DescriptorAllocator] failed to create descriptor pool of {} sets", sets_per_pool);
+            return VK_NULL_HANDLE;
+        }
+        return pool;
+    }
+
+    VkResult DescriptorAllocator::allocate_from(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet* descriptor_set) {
+        VkDescriptorSetAllocateInfo alloc_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        alloc_info.descriptorPool = pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &layout;
+        return vkAllocateDescriptorSets(device, &alloc_info, descriptor_set);
+    }
+
+    static bool is_pool_full(VkResult result) {
+        return result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL;
+    }
+
+    VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, VkDescriptorPool* pool) {
+        if (current_pool == VK_NULL_HANDLE) {
+            current_pool = grab_pool();
+            if (current_pool == VK_NULL_HANDLE) {
+                return VK_NULL_HANDLE;
+            }
+            used_pools.push_back(current_pool);
+        }
+
+        VkDescriptorSet descriptor_set{};
+        auto result = allocate_from(current_pool, layout, &descriptor_set);
+
+        //the current pool is full, older pools that had sets freed may fit it again.
+        while (is_pool_full(result) && !reclaimable_pools.empty()) {
+            VkDescriptorPool candidate = *reclaimable_pools.begin();
+            reclaimable_pools.erase(reclaimable_pools.begin());
+            if (candidate == current_pool) {
+                continue;
+            }
+            result = allocate_from(candidate, layout, &descriptor_set);
+            if (result == VK_SUCCESS) {
+                current_pool = candidate;
+            }
+        }
+
+        if (is_pool_full(result)) {
+            //every pool is full, chain a new one and retry once.
+            VkDescriptorPool next_pool = grab_pool();
+            if (next_pool == VK_NULL_HANDLE) {
+                return VK_NULL_HANDLE;
+            }
+            current_pool = next_pool;
+            used_pools.push_back(current_pool);
+            result = allocate_from(current_pool, layout, &descriptor_set);
+        }
+
+        if (result != VK_SUCCESS) {
+            spdlog::error("[DescriptorAllocator] failed to allocate descriptor set");
+            return VK_NULL_HANDLE;
+        }
+        if (flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) {
+            live_sets[current_pool]++;
+        }
+        if (pool != nullptr) {
+            *pool = current_pool;
+        }
+        return descriptor_set;
+    }
+
+    void DescriptorAllocator::free(VkDescriptorPool pool, VkDescriptorSet descriptor_set) {
+        vkFreeDescriptorSets(device, pool, 1, &descriptor_set);
+
+        auto it = live_sets.find(pool);
+        if (it == live_sets.end() || --it->second > 0) {
+            reclaimable_pools.insert(pool);
+            return;
+        }
+
+        //the pool is empty, a reset undoes any fragmentation and it goes back to the free list.
+        live_sets.erase(it);
+        reclaimable_pools.erase(pool);
+        vkResetDescriptorPool(device, pool, 0);
+        if (pool != current_pool) {
+            used_pools.erase(std::find(used_pools.begin(), used_pools.end(), pool));
+            free_pools.push_back(pool);
+        }
+    }
+
+    void DescriptorAllocator::reset() {
+        for (auto pool : used_pools) {
+            vkResetDescriptorPool(device, pool, 0);
+            free_pools.push_back(pool);
+        }
+        used_pools.clear();
+        live_sets.clear();
+        reclaimable_pools.clear();
+        current_pool = VK_NULL_HANDLE;
+    }
+
+}
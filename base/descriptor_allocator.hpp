@@ -0,0 +1,41 @@
+#pragma once
+
+#include "volk.h"
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace vk_sandbox {
+
+    //allocates descriptor sets from a chain of pools, a new pool is grabbed whenever the current one runs out.
+    //reset() returns every pool to the free list with a single vkResetDescriptorPool each, so nothing is freed one by one.
+    class DescriptorAllocator {
+    public:
+        void init(VkDevice device, uint32_t sets_per_pool = 1000, VkDescriptorPoolCreateFlags flags = 0);
+        void destroy();
+
+        //pool, when given, receives the pool the set came from so it can be freed on its own later.
+        VkDescriptorSet allocate(VkDescriptorSetLayout layout, VkDescriptorPool* pool = nullptr);
+        //only valid for allocators created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT.
+        //pools that empty out are reset and reused, pools with freed slots are retried before a new one is chained.
+        void free(VkDescriptorPool pool, VkDescriptorSet descriptor_set);
+        void reset();
+
+        size_t get_pool_count() const { return used_pools.size() + free_pools.size(); }
+    private:
+        VkDevice device{};
+        uint32_t sets_per_pool{};
+        VkDescriptorPoolCreateFlags flags{};
+
+        VkDescriptorPool current_pool{};
+        std::vector<VkDescriptorPool> used_pools;
+        std::vector<VkDescriptorPool> free_pools;
+        //only tracked with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+        std::unordered_map<VkDescriptorPool, uint32_t> live_sets;
+        std::unordered_set<VkDescriptorPool> reclaimable_pools;
+
+        VkDescriptorPool grab_pool();
+        VkResult allocate_from(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet* descriptor_set);
+    };
+
+}
@@ -0,0 +1,217 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include "descriptor_cache.hpp"
+#include "hash.hpp"
+
+namespace vk_sandbox {
+
+    static bool is_buffer_descriptor(VkDescriptorType type) {
+        return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+               type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    }
+
+    bool DescriptorLayoutKey::operator==(const DescriptorLayoutKey& other) const {
+        if (flags != other.flags || bindings.size() != other.bindings.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            const auto& a = bindings[i];
+            const auto& b = other.bindings[i];
+            if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+                a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t DescriptorLayoutKey::hash() const {
+        size_t seed = std::hash<uint32_t>{}(flags);
+        for (auto& binding : bindings) {
+            hash_combine(seed, binding.binding);
+            hash_combine(seed, static_cast<uint32_t>(binding.descriptorType));
+            hash_combine(seed, binding.descriptorCount);
+            hash_combine(seed, binding.stageFlags);
+        }
+        return seed;
+    }
+
+    bool DescriptorSetKey::operator==(const DescriptorSetKey& other) const {
+        if (layout != other.layout || bindings.size() != other.bindings.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            const auto& a = bindings[i];
+            const auto& b = other.bindings[i];
+            if (a.binding != b.binding || a.type != b.type) {
+                return false;
+            }
+            if (is_buffer_descriptor(a.type)) {
+                if (a.buffer_info.buffer != b.buffer_info.buffer || a.buffer_info.offset != b.buffer_info.offset ||
+                    a.buffer_info.range != b.buffer_info.range) {
+                    return false;
+                }
+            } else if (a.image_info.imageView != b.image_info.imageView || a.image_info.sampler != b.image_info.sampler ||
+                       a.image_info.imageLayout != b.image_info.imageLayout) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t DescriptorSetKey::hash() const {
+        size_t seed = std::hash<VkDescriptorSetLayout>{}(layout);
+        for (auto& binding : bindings) {
+            hash_combine(seed, binding.binding);
+            hash_combine(seed, static_cast<uint32_t>(binding.type));
+            if (is_buffer_descriptor(binding.type)) {
+                hash_combine(seed, binding.buffer_info.buffer);
+                hash_combine(seed, binding.buffer_info.offset);
+                hash_combine(seed, binding.buffer_info.range);
+            } else {
+                hash_combine(seed, binding.image_info.imageView);
+                hash_combine(seed, binding.image_info.sampler);
+                hash_combine(seed, static_cast<uint32_t>(binding.image_info.imageLayout));
+            }
+        }
+        return seed;
+    }
+
+    void DescriptorCache::init(VkDevice device) {
+        this->device = device;
+        //evicted sets are freed one by one.
+        set_allocator.init(device, 1000, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+    }
+
+    void DescriptorCache::destroy() {
+        for (auto& layout : layouts) {
+            vkDestroyDescriptorSetLayout(device, layout.second, nullptr);
+        }
+        layouts.clear();
+        sets.clear();
+        retired_sets.clear();
+        set_allocator.destroy();
+    }
+
+    VkDescriptorSetLayout DescriptorCache::get_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags) {
+        DescriptorLayoutKey key{};
+        key.flags = flags;
+        key.bindings = bindings;
+
+        //binding order in the description does not matter for the layout.
+        std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+            return a.binding < b.binding;
+        });
+
+        auto it = layouts.find(key);
+        if (it != layouts.end()) {
+            stats.layout_hits++;
+            return it->second;
+        }
+        stats.layout_misses++;
+
+        VkDescriptorSetLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+        layout_info.flags = flags;
+        layout_info.bindingCount = key.bindings.size();
+        layout_info.pBindings = key.bindings.data();
+
+        VkDescriptorSetLayout layout{};
+        if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &layout) != VK_SUCCESS) {
+            spdlog::error("[DescriptorCache] failed to create descriptor set layout");
+            return VK_NULL_HANDLE;
+        }
+
+        layouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    VkDescriptorSet DescriptorCache::get_set(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings) {
+        DescriptorSetKey key{};
+        key.layout = layout;
+        key.bindings = bindings;
+
+        std::sort(key.bindings.begin(), key.bindings.end(), [](const DescriptorBinding& a, const DescriptorBinding& b) {
+            return a.binding < b.binding;
+        });
+
+        auto it = sets.find(key);
+        if (it != sets.end()) {
+            stats.set_hits++;
+            return it->second.set;
+        }
+        stats.set_misses++;
+
+        VkDescriptorPool pool{};
+        VkDescriptorSet descriptor_set = set_allocator.allocate(layout, &pool);
+        if (descriptor_set == VK_NULL_HANDLE) {
+            return VK_NULL_HANDLE;
+        }
+
+        std::vector<VkWriteDescriptorSet> writes(key.bindings.size(), {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET});
+        for (size_t i = 0; i < key.bindings.size(); ++i) {
+            const DescriptorBinding& binding = key.bindings[i];
+            writes[i].dstSet = descriptor_set;
+            writes[i].dstBinding = binding.binding;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = binding.type;
+            if (is_buffer_descriptor(binding.type)) {
+                writes[i].pBufferInfo = &binding.buffer_info;
+            } else {
+                writes[i].pImageInfo = &binding.image_info;
+            }
+        }
+        vkUpdateDescriptorSets(device, writes.size(), writes.data(), 0, nullptr);
+
+        sets.emplace(std::move(key), CachedSet{descriptor_set, pool});
+        return descriptor_set;
+    }
+
+    static bool references(const DescriptorSetKey& key, uint64_t handle) {
+        for (auto& binding : key.bindings) {
+            if (is_buffer_descriptor(binding.type)) {
+                if (reinterpret_cast<uint64_t>(binding.buffer_info.buffer) == handle) {
+                    return true;
+                }
+            } else if (reinterpret_cast<uint64_t>(binding.image_info.imageView) == handle ||
+                       reinterpret_cast<uint64_t>(binding.image_info.sampler) == handle) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void DescriptorCache::evict(uint64_t handle, uint64_t frame_number) {
+        //resources are destroyed rarely compared to lookups, a linear scan keeps get_set free of bookkeeping.
+        for (auto it = sets.begin(); it != sets.end();) {
+            if (references(it->first, handle)) {
+                retired_sets.push_back({frame_number, it->second});
+                stats.set_evictions++;
+                it = sets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void DescriptorCache::evict_sets(uint64_t frame_number) {
+        for (auto& set : sets) {
+            retired_sets.push_back({frame_number, set.second});
+        }
+        stats.set_evictions += sets.size();
+        sets.clear();
+    }
+
+    void DescriptorCache::recycle(uint64_t frame_number, size_t frames_in_flight) {
+        while (!retired_sets.empty() && frame_number >= retired_sets.front().frame_number + frames_in_flight) {
+            set_allocator.free(retired_sets.front().cached.pool, retired_sets.front().cached.set);
+            retired_sets.pop_front();
+        }
+    }
+
+    void DescriptorCache::clear_sets() {
+        sets.clear();
+        retired_sets.clear();
+        set_allocator.reset();
+    }
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "volk.h"
+#include "descriptor_allocator.hpp"
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+namespace vk_sandbox {
+
+    //a resource bound to one binding, only the info matching the descriptor type is used.
+    struct DescriptorBinding {
+        uint32_t binding{};
+        VkDescriptorType type{};
+        VkDescriptorBufferInfo buffer_info{};
+        VkDescriptorImageInfo image_info{};
+    };
+
+    struct DescriptorLayoutKey {
+        VkDescriptorSetLayoutCreateFlags flags{};
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+        bool operator==(const DescriptorLayoutKey& other) const;
+        size_t hash() const;
+    };
+
+    struct DescriptorSetKey {
+        VkDescriptorSetLayout layout{};
+        std::vector<DescriptorBinding> bindings;
+
+        bool operator==(const DescriptorSetKey& other) const;
+        size_t hash() const;
+    };
+
+    struct DescriptorCacheStats {
+        uint64_t layout_hits{};
+        uint64_t layout_misses{};
+        uint64_t set_hits{};
+        uint64_t set_misses{};
+        uint64_t set_evictions{};
+    };
+
+    //shares descriptor set layouts by their bindings and immutable descriptor sets by the resources they bind,
+    //so repeated materials neither create layouts nor write descriptors again.
+    class DescriptorCache {
+    public:
+        void init(VkDevice device);
+        void destroy();
+
+        VkDescriptorSetLayout get_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
+        VkDescriptorSet get_set(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+
+        //forgets every set that binds the buffer, image view or sampler, so a recycled handle never hits a stale set.
+        //the sets themselves are freed by recycle() once frames_in_flight frames have passed.
+        void evict(uint64_t handle, uint64_t frame_number);
+        //forgets every cached set, freed like evicted ones.
+        void evict_sets(uint64_t frame_number);
+        void recycle(uint64_t frame_number, size_t frames_in_flight);
+
+        //drops every cached set, only valid once the GPU no longer uses them.
+        void clear_sets();
+
+        const DescriptorCacheStats& get_stats() const { return stats; }
+    private:
+        struct KeyHash {
+            template<typename T>
+            size_t operator()(const T& key) const { return key.hash(); }
+        };
+
+        VkDevice device{};
+        DescriptorAllocator set_allocator{};
+        DescriptorCacheStats stats{};
+
+        std::unordered_map<DescriptorLayoutKey, VkDescriptorSetLayout, KeyHash> layouts;
+        struct CachedSet {
+            VkDescriptorSet set{};
+            VkDescriptorPool pool{};
+        };
+
+        struct RetiredSet {
+            uint64_t frame_number{};
+            CachedSet cached{};
+        };
+
+        std::unordered_map<DescriptorSetKey, CachedSet, KeyHash> sets;
+        std::deque<RetiredSet> retired_sets;
+    };
+
+}
@@ -0,0 +1,107 @@
+#include "frame_stats.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace vk_sandbox {
+
+    static const char* get_metric_name(FrameMetric metric) {
+        switch (metric) {
+            case FrameMetric::cpu_frame: return "cpu frame";
+            case FrameMetric::gpu_frame: return "gpu frame";
+            case FrameMetric::fence_wait: return "fence wait";
+            case FrameMetric::present: return "present";
+            default: return "unknown";
+        }
+    }
+
+    //nearest rank on sorted samples
+    static double get_percentile(const std::vector<double>& sorted, double percentile) {
+        size_t rank = static_cast<size_t>(percentile * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    void FrameStats::init(uint32_t window_size, double log_interval_seconds) {
+        this->window_size = std::max(window_size, 1u);
+        log_interval = log_interval_seconds;
+        for (auto& samples : metrics) {
+            samples.values.clear();
+            samples.values.reserve(this->window_size);
+            samples.next = 0;
+        }
+        frame_count = 0;
+        interval_frame_count = 0;
+        interval_start = std::chrono::steady_clock::now();
+        fps = 0.0;
+    }
+
+    void FrameStats::add_sample(FrameMetric metric, double milliseconds) {
+        Samples& samples = metrics[static_cast<size_t>(metric)];
+        if (samples.values.size() < window_size) {
+            samples.values.push_back(milliseconds);
+        } else {
+            samples.values[samples.next] = milliseconds;
+            samples.next = (samples.next + 1) % window_size;
+        }
+    }
+
+    void FrameStats::end_frame() {
+        frame_count++;
+        interval_frame_count++;
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - interval_start).count();
+        if (log_interval <= 0.0 || elapsed < log_interval) {
+            return;
+        }
+
+        fps = interval_frame_count / elapsed;
+        interval_frame_count = 0;
+        interval_start = now;
+        log_summaries();
+    }
+
+    FrameMetricSummary FrameStats::get_summary(FrameMetric metric) const {
+        FrameMetricSummary summary{};
+        const std::vector<double>& values = metrics[static_cast<size_t>(metric)].values;
+        if (values.empty()) {
+            return summary;
+        }
+
+        std::vector<double> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0.0;
+        for (auto value : sorted) {
+            total += value;
+            size_t bucket = std::upper_bound(FRAME_HISTOGRAM_EDGES.begin(), FRAME_HISTOGRAM_EDGES.end(), value) - FRAME_HISTOGRAM_EDGES.begin();
+            summary.histogram[bucket]++;
+        }
+
+        summary.sample_count = sorted.size();
+        summary.average = total / sorted.size();
+        summary.min = sorted.front();
+        summary.max = sorted.back();
+        summary.p50 = get_percentile(sorted, 0.50);
+        summary.p95 = get_percentile(sorted, 0.95);
+        summary.p99 = get_percentile(sorted, 0.99);
+        return summary;
+    }
+
+    void FrameStats::log_summaries() const {
+        spdlog::info("[FrameStats] {} frames, {:.1f} fps", frame_count, fps);
+        for (size_t i = 0; i < metrics.size(); ++i) {
+            FrameMetric metric = static_cast<FrameMetric>(i);
+            FrameMetricSummary summary = get_summary(metric);
+            if (summary.sample_count == 0) {
+                continue;
+            }
+            spdlog::info("[FrameStats] {:<10} avg {:.2f} ms, p50 {:.2f}, p95 {:.2f}, p99 {:.2f}, max {:.2f}",
+                         get_metric_name(metric), summary.average, summary.p50, summary.p95, summary.p99, summary.max);
+        }
+
+        //pacing of the whole loop, one count per bucket from <4.17 ms to >=100 ms
+        FrameMetricSummary cpu_frame = get_summary(FrameMetric::cpu_frame);
+        spdlog::info("[FrameStats] frame histogram {}", fmt::join(cpu_frame.histogram, " "));
+    }
+
+}
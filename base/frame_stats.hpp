@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+namespace vk_sandbox {
+
+    enum class FrameMetric {
+        //wall time of one loop iteration
+        cpu_frame,
+        //the frame's timestamp region, resolved frames_in_flight frames late
+        gpu_frame,
+        //blocked waiting for the frame slot and the acquired image
+        fence_wait,
+        //blocked in vkQueuePresentKHR
+        present,
+        count
+    };
+
+    //upper edges in milliseconds: 240, 120, 90, 60, 30, 20 and 10 fps, the last bucket takes everything slower.
+    const std::array<double, 7> FRAME_HISTOGRAM_EDGES{4.17, 8.33, 11.1, 16.7, 33.3, 50.0, 100.0};
+    const size_t FRAME_HISTOGRAM_BUCKETS = FRAME_HISTOGRAM_EDGES.size() + 1;
+
+    struct FrameMetricSummary {
+        uint32_t sample_count{};
+        double average{};
+        double min{};
+        double max{};
+        double p50{};
+        double p95{};
+        double p99{};
+        std::array<uint32_t, FRAME_HISTOGRAM_BUCKETS> histogram{};
+    };
+
+    //rolling window of the last samples of each metric, percentiles over the window expose stutter averages hide.
+    class FrameStats {
+    public:
+        void init(uint32_t window_size = 1024, double log_interval_seconds = 5.0);
+
+        void add_sample(FrameMetric metric, double milliseconds);
+        //counts the frame and logs a summary of every metric once the interval elapsed, 0 disables logging.
+        void end_frame();
+
+        FrameMetricSummary get_summary(FrameMetric metric) const;
+        uint64_t get_frame_count() const { return frame_count; }
+        //over the last log interval
+        double get_fps() const { return fps; }
+    private:
+        struct Samples {
+            std::vector<double> values;
+            //next slot to overwrite once the window is full
+            size_t next{};
+        };
+
+        std::array<Samples, static_cast<size_t>(FrameMetric::count)> metrics{};
+        uint32_t window_size{};
+        double log_interval{};
+        uint64_t frame_count{};
+        uint64_t interval_frame_count{};
+        std::chrono::steady_clock::time_point interval_start{};
+        double fps{};
+
+        void log_summaries() const;
+    };
+
+}
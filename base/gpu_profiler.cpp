@@ -0,0 +1,123 @@
+#include "gpu_profiler.hpp"
+#include <spdlog/spdlog.h>
+
+namespace vk_sandbox {
+
+    void GpuProfiler::init(VkDevice device, uint32_t frames_in_flight, float timestamp_period, uint32_t timestamp_valid_bits,
+                           uint32_t max_regions) {
+        this->device = device;
+        this->max_regions = max_regions;
+        //nanoseconds per tick
+        this->timestamp_period = timestamp_period;
+
+        if (timestamp_valid_bits == 0) {
+            spdlog::warn("[GpuProfiler] the graphics queue has no timestamp support, GPU profiling is disabled");
+            return;
+        }
+        timestamp_mask = timestamp_valid_bits >= 64 ? UINT64_MAX : (1ull << timestamp_valid_bits) - 1;
+
+        VkQueryPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        pool_info.queryCount = max_regions * 2;
+
+        pools.resize(frames_in_flight);
+        for (auto& frame_pool : pools) {
+            if (vkCreateQueryPool(device, &pool_info, nullptr, &frame_pool.pool) != VK_SUCCESS) {
+                spdlog::error("[GpuProfiler] failed to create timestamp query pool");
+                destroy();
+                return;
+            }
+            frame_pool.regions.reserve(max_regions);
+        }
+        query_results.resize(max_regions * 4);
+    }
+
+    void GpuProfiler::destroy() {
+        for (auto& frame_pool : pools) {
+            vkDestroyQueryPool(device, frame_pool.pool, nullptr);
+        }
+        pools.clear();
+    }
+
+    void GpuProfiler::begin_frame(VkCommandBuffer cmd, uint32_t frame_index) {
+        if (!is_enabled()) {
+            return;
+        }
+        current_pool = frame_index;
+        open_depth = 0;
+
+        FramePool& frame_pool = pools[current_pool];
+        if (!frame_pool.regions.empty()) {
+            resolve(frame_pool);
+            frame_pool.regions.clear();
+        }
+        vkCmdResetQueryPool(cmd, frame_pool.pool, 0, max_regions * 2);
+    }
+
+    uint32_t GpuProfiler::begin_region(VkCommandBuffer cmd, const std::string& name) {
+        if (!is_enabled()) {
+            return INVALID_GPU_REGION;
+        }
+
+        FramePool& frame_pool = pools[current_pool];
+        if (frame_pool.regions.size() == max_regions) {
+            if (!overflow_reported) {
+                spdlog::warn("[GpuProfiler] more than {} regions in a frame, the rest are not timed", max_regions);
+                overflow_reported = true;
+            }
+            return INVALID_GPU_REGION;
+        }
+
+        uint32_t region = frame_pool.regions.size();
+        frame_pool.regions.push_back({name, open_depth++, false});
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame_pool.pool, region * 2);
+        return region;
+    }
+
+    void GpuProfiler::end_region(VkCommandBuffer cmd, uint32_t region) {
+        if (region == INVALID_GPU_REGION) {
+            return;
+        }
+
+        FramePool& frame_pool = pools[current_pool];
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame_pool.pool, region * 2 + 1);
+        frame_pool.regions[region].closed = true;
+        open_depth--;
+    }
+
+    double GpuProfiler::get_milliseconds(const std::string& name) const {
+        double milliseconds = 0.0;
+        for (auto& timing : timings) {
+            if (timing.name == name) {
+                milliseconds += timing.milliseconds;
+            }
+        }
+        return milliseconds;
+    }
+
+    void GpuProfiler::resolve(FramePool& frame_pool) {
+        uint32_t query_count = frame_pool.regions.size() * 2;
+
+        //the slot's fence already signaled, without the wait bit an unwritten query reports unavailable instead of blocking.
+        VkResult result = vkGetQueryPoolResults(device, frame_pool.pool, 0, query_count,
+                                                query_count * 2 * sizeof(uint64_t), query_results.data(), 2 * sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY) {
+            return;
+        }
+
+        timings.clear();
+        for (uint32_t i = 0; i < frame_pool.regions.size(); ++i) {
+            const Region& region = frame_pool.regions[i];
+            const uint64_t* begin = &query_results[i * 4];
+            const uint64_t* end = &query_results[i * 4 + 2];
+            if (!region.closed || begin[1] == 0 || end[1] == 0) {
+                continue;
+            }
+
+            uint64_t ticks = (end[0] - begin[0]) & timestamp_mask;
+            timings.push_back({region.name, region.depth, ticks * timestamp_period / 1e6});
+        }
+    }
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "volk.h"
+#include <vector>
+#include <string>
+
+namespace vk_sandbox {
+
+    const uint32_t INVALID_GPU_REGION = UINT32_MAX;
+
+    struct GpuTiming {
+        std::string name;
+        //nesting level, regions opened inside another one are one deeper
+        uint32_t depth{};
+        double milliseconds{};
+    };
+
+    //timestamp pairs around passes and user regions, one query pool per frame slot. A slot's queries are read back
+    //once its fence signaled, frames_in_flight frames later, so results never wait on the GPU.
+    class GpuProfiler {
+    public:
+        void init(VkDevice device, uint32_t frames_in_flight, float timestamp_period, uint32_t timestamp_valid_bits,
+                  uint32_t max_regions = 256);
+        void destroy();
+
+        //the slot's previous frame has completed: resolve its regions and reset the pool, before any render pass.
+        void begin_frame(VkCommandBuffer cmd, uint32_t frame_index);
+
+        //regions are recorded into primary command buffers and close in reverse order of opening.
+        uint32_t begin_region(VkCommandBuffer cmd, const std::string& name);
+        void end_region(VkCommandBuffer cmd, uint32_t region);
+
+        bool is_enabled() const { return !pools.empty(); }
+        //timings of the latest resolved frame, in the order the regions were opened.
+        const std::vector<GpuTiming>& get_timings() const { return timings; }
+        //summed over every region with the name, 0 when it wasn't recorded.
+        double get_milliseconds(const std::string& name) const;
+
+        class Scope {
+        public:
+            Scope(GpuProfiler& profiler, VkCommandBuffer cmd, const std::string& name)
+                : profiler(profiler), cmd(cmd), region(profiler.begin_region(cmd, name)) {}
+            ~Scope() { profiler.end_region(cmd, region); }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        private:
+            GpuProfiler& profiler;
+            VkCommandBuffer cmd;
+            uint32_t region;
+        };
+    private:
+        struct Region {
+            std::string name;
+            uint32_t depth{};
+            bool closed{false};
+        };
+
+        struct FramePool {
+            VkQueryPool pool{};
+            //region i owns queries 2i and 2i+1
+            std::vector<Region> regions;
+        };
+
+        VkDevice device{};
+        std::vector<FramePool> pools;
+        uint32_t current_pool{};
+        uint32_t max_regions{};
+        double timestamp_period{};
+        uint64_t timestamp_mask{};
+        uint32_t open_depth{};
+        bool overflow_reported{false};
+
+        std::vector<GpuTiming> timings;
+        //scratch for vkGetQueryPoolResults, a value and its availability per query
+        std::vector<uint64_t> query_results;
+
+        void resolve(FramePool& frame_pool);
+    };
+
+}
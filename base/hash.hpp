@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace vk_sandbox {
+
+    inline void hash_combine(size_t& seed, size_t value) {
+        seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+
+    template<typename T>
+    inline void hash_combine(size_t& seed, const T& value) {
+        hash_combine(seed, std::hash<T>{}(value));
+    }
+
+}
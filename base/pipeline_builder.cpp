@@ -0,0 +1,384 @@
+#include <spdlog/spdlog.h>
+#include "pipeline_builder.hpp"
+#include "hash.hpp"
+
+namespace vk_sandbox {
+
+    bool GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc& other) const {
+        if (shader_stages.size() != other.shader_stages.size() ||
+            vertex_bindings.size() != other.vertex_bindings.size() ||
+            vertex_attributes.size() != other.vertex_attributes.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < shader_stages.size(); ++i) {
+            if (shader_stages[i].stage != other.shader_stages[i].stage || shader_stages[i].module != other.shader_stages[i].module ||
+                shader_stages[i].entry_point != other.shader_stages[i].entry_point) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < vertex_bindings.size(); ++i) {
+            if (vertex_bindings[i].binding != other.vertex_bindings[i].binding || vertex_bindings[i].stride != other.vertex_bindings[i].stride ||
+                vertex_bindings[i].inputRate != other.vertex_bindings[i].inputRate) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < vertex_attributes.size(); ++i) {
+            if (vertex_attributes[i].location != other.vertex_attributes[i].location || vertex_attributes[i].binding != other.vertex_attributes[i].binding ||
+                vertex_attributes[i].format != other.vertex_attributes[i].format || vertex_attributes[i].offset != other.vertex_attributes[i].offset) {
+                return false;
+            }
+        }
+        return topology == other.topology && polygon_mode == other.polygon_mode && cull_mode == other.cull_mode &&
+               front_face == other.front_face && depth_test == other.depth_test && depth_write == other.depth_write &&
+               depth_compare == other.depth_compare && blend == other.blend && src_color_blend == other.src_color_blend &&
+               dst_color_blend == other.dst_color_blend && color_blend_op == other.color_blend_op &&
+               color_attachment_count == other.color_attachment_count && samples == other.samples &&
+               layout == other.layout && render_pass == other.render_pass && subpass == other.subpass;
+    }
+
+    size_t GraphicsPipelineDesc::hash() const {
+        size_t seed = 0;
+        for (auto& shader_stage : shader_stages) {
+            hash_combine(seed, static_cast<uint32_t>(shader_stage.stage));
+            hash_combine(seed, shader_stage.module);
+            hash_combine(seed, shader_stage.entry_point);
+        }
+        for (auto& binding : vertex_bindings) {
+            hash_combine(seed, binding.binding);
+            hash_combine(seed, binding.stride);
+            hash_combine(seed, static_cast<uint32_t>(binding.inputRate));
+        }
+        for (auto& attribute : vertex_attributes) {
+            hash_combine(seed, attribute.location);
+            hash_combine(seed, attribute.binding);
+            hash_combine(seed, static_cast<uint32_t>(attribute.format));
+            hash_combine(seed, attribute.offset);
+        }
+        hash_combine(seed, static_cast<uint32_t>(topology));
+        hash_combine(seed, static_cast<uint32_t>(polygon_mode));
+        hash_combine(seed, cull_mode);
+        hash_combine(seed, static_cast<uint32_t>(front_face));
+        hash_combine(seed, depth_test);
+        hash_combine(seed, depth_write);
+        hash_combine(seed, static_cast<uint32_t>(depth_compare));
+        hash_combine(seed, blend);
+        hash_combine(seed, static_cast<uint32_t>(src_color_blend));
+        hash_combine(seed, static_cast<uint32_t>(dst_color_blend));
+        hash_combine(seed, static_cast<uint32_t>(color_blend_op));
+        hash_combine(seed, color_attachment_count);
+        hash_combine(seed, static_cast<uint32_t>(samples));
+        hash_combine(seed, layout);
+        hash_combine(seed, render_pass);
+        hash_combine(seed, subpass);
+        return seed;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::add_shader(VkShaderStageFlagBits stage, VkShaderModule module, const std::string& entry_point) {
+        desc.shader_stages.push_back({stage, module, entry_point});
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::add_vertex_binding(uint32_t binding, uint32_t stride, VkVertexInputRate input_rate) {
+        desc.vertex_bindings.push_back({binding, stride, input_rate});
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::add_vertex_attribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset) {
+        desc.vertex_attributes.push_back({location, binding, format, offset});
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_topology(VkPrimitiveTopology topology) {
+        desc.topology = topology;
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_raster(VkPolygonMode polygon_mode, VkCullModeFlags cull_mode, VkFrontFace front_face) {
+        desc.polygon_mode = polygon_mode;
+        desc.cull_mode = cull_mode;
+        desc.front_face = front_face;
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_depth(bool test, bool write, VkCompareOp compare) {
+        desc.depth_test = test;
+        desc.depth_write = write;
+        desc.depth_compare = compare;
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_blend(bool enable, VkBlendFactor src, VkBlendFactor dst, VkBlendOp op) {
+        desc.blend = enable;
+        desc.src_color_blend = src;
+        desc.dst_color_blend = dst;
+        desc.color_blend_op = op;
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_samples(VkSampleCountFlagBits samples) {
+        desc.samples = samples;
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_layout(VkPipelineLayout layout) {
+        desc.layout = layout;
+        return *this;
+    }
+
+    GraphicsPipelineBuilder& GraphicsPipelineBuilder::set_render_pass(VkRenderPass render_pass, uint32_t subpass, uint32_t color_attachment_count) {
+        desc.render_pass = render_pass;
+        desc.subpass = subpass;
+        desc.color_attachment_count = color_attachment_count;
+        return *this;
+    }
+
+    VkPipeline GraphicsPipelineBuilder::build(VkDevice device, VkPipelineCache pipeline_cache, const GraphicsPipelineDesc& desc) {
+        std::vector<VkPipelineShaderStageCreateInfo> stages;
+        for (auto& shader_stage : desc.shader_stages) {
+            VkPipelineShaderStageCreateInfo stage_info{VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
+            stage_info.stage = shader_stage.stage;
+            stage_info.module = shader_stage.module;
+            stage_info.pName = shader_stage.entry_point.c_str();
+            stages.push_back(stage_info);
+        }
+
+        VkPipelineVertexInputStateCreateInfo vertex_input{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+        vertex_input.vertexBindingDescriptionCount = desc.vertex_bindings.size();
+        vertex_input.pVertexBindingDescriptions = desc.vertex_bindings.data();
+        vertex_input.vertexAttributeDescriptionCount = desc.vertex_attributes.size();
+        vertex_input.pVertexAttributeDescriptions = desc.vertex_attributes.data();
+
+        VkPipelineInputAssemblyStateCreateInfo input_assembly{VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+        input_assembly.topology = desc.topology;
+
+        //viewport and scissor are set when the render pass begins.
+        VkPipelineViewportStateCreateInfo viewport_state{VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+        viewport_state.viewportCount = 1;
+        viewport_state.scissorCount = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterization{VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+        rasterization.polygonMode = desc.polygon_mode;
+        rasterization.cullMode = desc.cull_mode;
+        rasterization.frontFace = desc.front_face;
+        rasterization.lineWidth = 1.f;
+
+        VkPipelineMultisampleStateCreateInfo multisample{VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+        multisample.rasterizationSamples = desc.samples;
+
+        VkPipelineDepthStencilStateCreateInfo depth_stencil{VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+        depth_stencil.depthTestEnable = desc.depth_test;
+        depth_stencil.depthWriteEnable = desc.depth_write;
+        depth_stencil.depthCompareOp = desc.depth_compare;
+        depth_stencil.maxDepthBounds = 1.f;
+
+        VkPipelineColorBlendAttachmentState blend_attachment{};
+        blend_attachment.blendEnable = desc.blend;
+        blend_attachment.srcColorBlendFactor = desc.src_color_blend;
+        blend_attachment.dstColorBlendFactor = desc.dst_color_blend;
+        blend_attachment.colorBlendOp = desc.color_blend_op;
+        blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+        std::vector<VkPipelineColorBlendAttachmentState> blend_attachments(desc.color_attachment_count, blend_attachment);
+
+        VkPipelineColorBlendStateCreateInfo color_blend{VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+        color_blend.attachmentCount = blend_attachments.size();
+        color_blend.pAttachments = blend_attachments.data();
+
+        VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamic_state{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+        dynamic_state.dynamicStateCount = 2;
+        dynamic_state.pDynamicStates = dynamic_states;
+
+        VkGraphicsPipelineCreateInfo pipeline_info{VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+        pipeline_info.stageCount = stages.size();
+        pipeline_info.pStages = stages.data();
+        pipeline_info.pVertexInputState = &vertex_input;
+        pipeline_info.pInputAssemblyState = &input_assembly;
+        pipeline_info.pViewportState = &viewport_state;
+        pipeline_info.pRasterizationState = &rasterization;
+        pipeline_info.pMultisampleState = &multisample;
+        pipeline_info.pDepthStencilState = &depth_stencil;
+        pipeline_info.pColorBlendState = &color_blend;
+        pipeline_info.pDynamicState = &dynamic_state;
+        pipeline_info.layout = desc.layout;
+        pipeline_info.renderPass = desc.render_pass;
+        pipeline_info.subpass = desc.subpass;
+
+        VkPipeline pipeline{};
+        if (vkCreateGraphicsPipelines(device, pipeline_cache, 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS) {
+            spdlog::error("[GraphicsPipelineBuilder] failed to create graphics pipeline");
+            return VK_NULL_HANDLE;
+        }
+        return pipeline;
+    }
+
+    void PipelineStateCache::init(VkDevice device, VkPipelineCache pipeline_cache, uint32_t worker_count) {
+        this->device = device;
+        this->pipeline_cache = pipeline_cache;
+
+        stopping = false;
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            workers.emplace_back(&PipelineStateCache::worker_loop, this);
+        }
+    }
+
+    void PipelineStateCache::destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobs_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        //anything still queued is abandoned, waiters see a null pipeline.
+        for (auto& job : jobs) {
+            job.promise.set_value(VK_NULL_HANDLE);
+        }
+        jobs.clear();
+
+        for (auto& pipeline : pipelines) {
+            VkPipeline vk_pipeline = pipeline.second.get();
+            if (vk_pipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device, vk_pipeline, nullptr);
+            }
+        }
+        pipelines.clear();
+    }
+
+    VkPipeline PipelineStateCache::get_or_create(const GraphicsPipelineDesc& desc) {
+        std::promise<VkPipeline> promise;
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = pipelines.find(desc);
+        if (it != pipelines.end()) {
+            std::shared_future<VkPipeline> future = it->second;
+            lock.unlock();
+            return future.get();
+        }
+        pipelines.emplace(desc, promise.get_future().share());
+        lock.unlock();
+
+        //compile outside the lock, vkCreateGraphicsPipelines and the VkPipelineCache are internally synchronized.
+        VkPipeline pipeline = GraphicsPipelineBuilder::build(device, pipeline_cache, desc);
+        promise.set_value(pipeline);
+        return pipeline;
+    }
+
+    VkPipeline PipelineStateCache::get_or_request(const GraphicsPipelineDesc& desc, VkPipeline fallback) {
+        if (workers.empty()) {
+            return get_or_create(desc);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pipelines.find(desc);
+        if (it != pipelines.end()) {
+            if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return fallback;
+            }
+            VkPipeline pipeline = it->second.get();
+            return pipeline != VK_NULL_HANDLE ? pipeline : fallback;
+        }
+
+        CompileJob job{desc};
+        pipelines.emplace(desc, job.promise.get_future().share());
+        jobs.push_back(std::move(job));
+        jobs_available.notify_one();
+        return fallback;
+    }
+
+    void PipelineStateCache::worker_loop() {
+        while (true) {
+            CompileJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobs_available.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job.promise.set_value(GraphicsPipelineBuilder::build(device, pipeline_cache, job.desc));
+        }
+    }
+
+    VkPipeline PipelineStateCache::find(const GraphicsPipelineDesc& desc) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pipelines.find(desc);
+        if (it == pipelines.end() || it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return VK_NULL_HANDLE;
+        }
+        return it->second.get();
+    }
+
+    std::vector<VkPipeline> PipelineStateCache::evict(uint64_t handle) {
+        auto references = [handle](const GraphicsPipelineDesc& desc) {
+            return reinterpret_cast<uint64_t>(desc.layout) == handle || reinterpret_cast<uint64_t>(desc.render_pass) == handle;
+        };
+
+        std::vector<std::shared_future<VkPipeline>> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            //queued compiles are dropped before a worker picks them up.
+            for (auto it = jobs.begin(); it != jobs.end();) {
+                if (references(it->desc)) {
+                    it->promise.set_value(VK_NULL_HANDLE);
+                    it = jobs.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            for (auto it = pipelines.begin(); it != pipelines.end();) {
+                if (references(it->first)) {
+                    evicted.push_back(it->second);
+                    it = pipelines.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        //compiles already running finish outside the lock.
+        std::vector<VkPipeline> result;
+        for (auto& future : evicted) {
+            VkPipeline pipeline = future.get();
+            if (pipeline != VK_NULL_HANDLE) {
+                result.push_back(pipeline);
+            }
+        }
+        return result;
+    }
+
+    bool PipelineStateCache::owns(VkPipeline pipeline) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : pipelines) {
+            if (entry.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready && entry.second.get() == pipeline) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t PipelineStateCache::size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pipelines.size();
+    }
+
+    size_t PipelineStateCache::get_pending_count() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t pending = 0;
+        for (auto& pipeline : pipelines) {
+            if (pipeline.second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++pending;
+            }
+        }
+        return pending;
+    }
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "volk.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <future>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+namespace vk_sandbox {
+
+    struct ShaderStage {
+        VkShaderStageFlagBits stage{};
+        VkShaderModule module{};
+        std::string entry_point{"main"};
+    };
+
+    //the full state of a graphics pipeline, two equal descriptions always produce interchangeable pipelines.
+    struct GraphicsPipelineDesc {
+        std::vector<ShaderStage> shader_stages;
+        std::vector<VkVertexInputBindingDescription> vertex_bindings;
+        std::vector<VkVertexInputAttributeDescription> vertex_attributes;
+
+        VkPrimitiveTopology topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+        VkPolygonMode polygon_mode{VK_POLYGON_MODE_FILL};
+        VkCullModeFlags cull_mode{VK_CULL_MODE_NONE};
+        VkFrontFace front_face{VK_FRONT_FACE_COUNTER_CLOCKWISE};
+
+        bool depth_test{false};
+        bool depth_write{false};
+        VkCompareOp depth_compare{VK_COMPARE_OP_LESS_OR_EQUAL};
+
+        bool blend{false};
+        VkBlendFactor src_color_blend{VK_BLEND_FACTOR_SRC_ALPHA};
+        VkBlendFactor dst_color_blend{VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA};
+        VkBlendOp color_blend_op{VK_BLEND_OP_ADD};
+
+        uint32_t color_attachment_count{1};
+        VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+
+        VkPipelineLayout layout{};
+        VkRenderPass render_pass{};
+        uint32_t subpass{0};
+
+        bool operator==(const GraphicsPipelineDesc& other) const;
+        size_t hash() const;
+    };
+
+    class GraphicsPipelineBuilder {
+    public:
+        GraphicsPipelineBuilder& add_shader(VkShaderStageFlagBits stage, VkShaderModule module, const std::string& entry_point = "main");
+        GraphicsPipelineBuilder& add_vertex_binding(uint32_t binding, uint32_t stride, VkVertexInputRate input_rate = VK_VERTEX_INPUT_RATE_VERTEX);
+        GraphicsPipelineBuilder& add_vertex_attribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset);
+        GraphicsPipelineBuilder& set_topology(VkPrimitiveTopology topology);
+        GraphicsPipelineBuilder& set_raster(VkPolygonMode polygon_mode, VkCullModeFlags cull_mode, VkFrontFace front_face);
+        GraphicsPipelineBuilder& set_depth(bool test, bool write, VkCompareOp compare = VK_COMPARE_OP_LESS_OR_EQUAL);
+        GraphicsPipelineBuilder& set_blend(bool enable, VkBlendFactor src = VK_BLEND_FACTOR_SRC_ALPHA,
+                                           VkBlendFactor dst = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VkBlendOp op = VK_BLEND_OP_ADD);
+        GraphicsPipelineBuilder& set_samples(VkSampleCountFlagBits samples);
+        GraphicsPipelineBuilder& set_layout(VkPipelineLayout layout);
+        GraphicsPipelineBuilder& set_render_pass(VkRenderPass render_pass, uint32_t subpass = 0, uint32_t color_attachment_count = 1);
+
+        const GraphicsPipelineDesc& get_desc() const { return desc; }
+
+        static VkPipeline build(VkDevice device, VkPipelineCache pipeline_cache, const GraphicsPipelineDesc& desc);
+    private:
+        GraphicsPipelineDesc desc{};
+    };
+
+    //dedups pipelines by description. Safe to call from any thread: concurrent requests for the same
+    //description compile once and the other callers wait on the first compile instead of racing it.
+    class PipelineStateCache {
+    public:
+        void init(VkDevice device, VkPipelineCache pipeline_cache, uint32_t worker_count = 0);
+        void destroy();
+
+        VkPipeline get_or_create(const GraphicsPipelineDesc& desc);
+        //never blocks, queues the compile on the workers and returns fallback until the pipeline is ready.
+        VkPipeline get_or_request(const GraphicsPipelineDesc& desc, VkPipeline fallback = VK_NULL_HANDLE);
+        //returns null without blocking when the pipeline was never requested or is still compiling.
+        VkPipeline find(const GraphicsPipelineDesc& desc);
+        //forgets every pipeline built against the layout or render pass, waiting for their compiles to finish.
+        //the caller owns the returned pipelines and destroys them once the GPU no longer uses them.
+        std::vector<VkPipeline> evict(uint64_t handle);
+        bool owns(VkPipeline pipeline);
+
+        size_t size();
+        size_t get_pending_count();
+    private:
+        struct DescHash {
+            size_t operator()(const GraphicsPipelineDesc& desc) const { return desc.hash(); }
+        };
+
+        struct CompileJob {
+            GraphicsPipelineDesc desc;
+            std::promise<VkPipeline> promise;
+        };
+
+        void worker_loop();
+
+        VkDevice device{};
+        VkPipelineCache pipeline_cache{};
+
+        std::mutex mutex;
+        std::unordered_map<GraphicsPipelineDesc, std::shared_future<VkPipeline>, DescHash> pipelines;
+
+        //background compiles
+        std::vector<std::thread> workers;
+        std::deque<CompileJob> jobs;
+        std::condition_variable jobs_available;
+        bool stopping{false};
+    };
+
+}
@@ -0,0 +1,995 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include "render_graph.hpp"
+#include "vulkan_context.hpp"
+#include "hash.hpp"
+
+namespace vk_sandbox {
+
+    //physical images and framebuffers nothing has asked for in this many frames are released.
+    const uint64_t UNUSED_RELEASE_FRAMES = 16;
+
+    struct RenderAccessInfo {
+        VkImageLayout layout;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        bool write;
+    };
+
+    static RenderAccessInfo get_access_info(const RenderResourceUse& use) {
+        switch (use.access) {
+            case RenderAccess::color_attachment:
+                return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        static_cast<VkAccessFlags>(use.clear ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                                             : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT), true};
+            case RenderAccess::depth_attachment:
+                return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true};
+            case RenderAccess::depth_read:
+                return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, false};
+            case RenderAccess::sampled:
+                return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, use.stages, VK_ACCESS_SHADER_READ_BIT, false};
+            case RenderAccess::storage_read:
+                return {VK_IMAGE_LAYOUT_GENERAL, use.stages, VK_ACCESS_SHADER_READ_BIT, false};
+            case RenderAccess::storage_write:
+                return {VK_IMAGE_LAYOUT_GENERAL, use.stages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, true};
+        }
+        return {};
+    }
+
+    static VkImageUsageFlags get_access_usage(RenderAccess access) {
+        switch (access) {
+            case RenderAccess::color_attachment:
+                return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            case RenderAccess::depth_attachment:
+            case RenderAccess::depth_read:
+                return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            case RenderAccess::sampled:
+                return VK_IMAGE_USAGE_SAMPLED_BIT;
+            case RenderAccess::storage_read:
+            case RenderAccess::storage_write:
+                return VK_IMAGE_USAGE_STORAGE_BIT;
+        }
+        return 0;
+    }
+
+    RenderGraphPass& RenderGraphPass::write_color(RenderResource image, std::optional<VkClearColorValue> clear) {
+        RenderResourceUse use{image, RenderAccess::color_attachment};
+        if (clear) {
+            use.clear = true;
+            use.clear_value.color = *clear;
+        }
+        uses.push_back(use);
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::write_depth(RenderResource image, std::optional<VkClearDepthStencilValue> clear) {
+        RenderResourceUse use{image, RenderAccess::depth_attachment};
+        if (clear) {
+            use.clear = true;
+            use.clear_value.depthStencil = *clear;
+        }
+        uses.push_back(use);
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::read_depth(RenderResource image) {
+        uses.push_back({image, RenderAccess::depth_read});
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::read_texture(RenderResource image, VkPipelineStageFlags stages) {
+        uses.push_back({image, RenderAccess::sampled, stages});
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::read_storage(RenderResource resource, VkPipelineStageFlags stages) {
+        uses.push_back({resource, RenderAccess::storage_read, stages});
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::write_storage(RenderResource resource, VkPipelineStageFlags stages) {
+        uses.push_back({resource, RenderAccess::storage_write, stages});
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::set_side_effects() {
+        side_effects = true;
+        return *this;
+    }
+
+    RenderGraphPass& RenderGraphPass::set_execute(std::function<void(VkCommandBuffer)> execute) {
+        this->execute = std::move(execute);
+        return *this;
+    }
+
+    bool RenderGraph::RenderPassKey::operator==(const RenderPassKey& other) const {
+        return color_count == other.color_count && has_depth == other.has_depth &&
+               attachments.size() == other.attachments.size() &&
+               std::memcmp(attachments.data(), other.attachments.data(), attachments.size() * sizeof(VkAttachmentDescription)) == 0;
+    }
+
+    size_t RenderGraph::RenderPassKey::hash() const {
+        size_t seed = 0;
+        hash_combine(seed, color_count);
+        hash_combine(seed, has_depth);
+        for (auto& attachment : attachments) {
+            hash_combine(seed, static_cast<uint32_t>(attachment.format));
+            hash_combine(seed, static_cast<uint32_t>(attachment.samples));
+            hash_combine(seed, static_cast<uint32_t>(attachment.loadOp));
+            hash_combine(seed, static_cast<uint32_t>(attachment.storeOp));
+            hash_combine(seed, static_cast<uint32_t>(attachment.stencilLoadOp));
+            hash_combine(seed, static_cast<uint32_t>(attachment.stencilStoreOp));
+            hash_combine(seed, static_cast<uint32_t>(attachment.initialLayout));
+            hash_combine(seed, static_cast<uint32_t>(attachment.finalLayout));
+        }
+        return seed;
+    }
+
+    bool RenderGraph::FramebufferKey::operator==(const FramebufferKey& other) const {
+        return render_pass == other.render_pass && attachments == other.attachments && usages == other.usages &&
+               extent.width == other.extent.width && extent.height == other.extent.height;
+    }
+
+    size_t RenderGraph::FramebufferKey::hash() const {
+        size_t seed = 0;
+        hash_combine(seed, render_pass);
+        for (auto attachment : attachments) {
+            hash_combine(seed, attachment);
+        }
+        for (auto usage : usages) {
+            hash_combine(seed, usage);
+        }
+        hash_combine(seed, extent.width);
+        hash_combine(seed, extent.height);
+        return seed;
+    }
+
+    void RenderGraph::init(VulkanContext* context) {
+        this->context = context;
+    }
+
+    void RenderGraph::destroy() {
+        for (auto& physical_image : physical_images) {
+            if (physical_image.image.image != VK_NULL_HANDLE) {
+                context->destroy_deferred(physical_image.image);
+            }
+        }
+        for (auto& heap : heaps) {
+            context->destroy_deferred(heap.allocation);
+        }
+        heaps.clear();
+        for (auto& framebuffer : framebuffers) {
+            context->destroy_deferred(framebuffer.second.framebuffer);
+        }
+        for (auto& render_pass : render_passes) {
+            context->destroy_deferred(render_pass.second);
+        }
+        physical_images.clear();
+        framebuffers.clear();
+        render_passes.clear();
+        reset();
+    }
+
+    void RenderGraph::reset() {
+        resources.clear();
+        passes.clear();
+        compiled_passes.clear();
+        stats = {};
+    }
+
+    RenderResource RenderGraph::create_image(const std::string& name, const RenderImageDesc& desc) {
+        Resource resource{};
+        resource.name = name;
+        resource.desc = desc;
+        resources.push_back(resource);
+        return resources.size() - 1;
+    }
+
+    RenderResource RenderGraph::import_image(const std::string& name, const VulkanImage& image, VkImageLayout initial_layout, VkImageLayout final_layout) {
+        Resource resource{};
+        resource.name = name;
+        resource.imported = true;
+        resource.image = image;
+        resource.desc.format = image.image_format;
+        resource.desc.size = {image.extent.width, image.extent.height};
+        resource.state.layout = initial_layout;
+        resource.final_layout = final_layout;
+        resources.push_back(resource);
+        return resources.size() - 1;
+    }
+
+    RenderResource RenderGraph::import_buffer(const std::string& name, const VulkanBuffer& buffer) {
+        Resource resource{};
+        resource.name = name;
+        resource.imported = true;
+        resource.is_buffer = true;
+        resource.buffer = buffer.buffer;
+        resources.push_back(resource);
+        return resources.size() - 1;
+    }
+
+    RenderResource RenderGraph::import_backbuffer() {
+        RenderResource backbuffer = import_image("backbuffer", context->get_backbuffer(),
+                                                 VK_IMAGE_LAYOUT_UNDEFINED, context->get_backbuffer_final_layout());
+        //the acquire semaphore is waited at color attachment output, the first transition has to chain after it.
+        resources[backbuffer].backbuffer = true;
+        resources[backbuffer].state.write_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        return backbuffer;
+    }
+
+    RenderGraphPass& RenderGraph::add_pass(const std::string& name) {
+        passes.emplace_back();
+        passes.back().name = name;
+        return passes.back();
+    }
+
+    VkRenderPass RenderGraph::get_render_pass(const std::string& pass_name) const {
+        for (auto& compiled : compiled_passes) {
+            if (passes[compiled.pass].name == pass_name) {
+                return compiled.render_pass;
+            }
+        }
+        return VK_NULL_HANDLE;
+    }
+
+    void RenderGraph::compile() {
+        compiled_passes.clear();
+        stats = {};
+        stats.pass_count = passes.size();
+
+        std::vector<uint32_t> order = sort_passes();
+        stats.culled_pass_count = passes.size() - order.size();
+
+        for (uint32_t position = 0; position < order.size(); ++position) {
+            for (auto& use : passes[order[position]].uses) {
+                Resource& resource = resources[use.resource];
+                resource.first_use = std::min(resource.first_use, position);
+                resource.last_use = std::max(resource.last_use, position);
+                resource.usage |= get_access_usage(use.access);
+            }
+        }
+
+        assign_physical_images();
+
+        for (uint32_t position = 0; position < order.size(); ++position) {
+            CompiledPass compiled{order[position]};
+            build_render_pass(compiled, position);
+            compiled_passes.push_back(std::move(compiled));
+        }
+    }
+
+    std::vector<uint32_t> RenderGraph::sort_passes() {
+        size_t pass_count = passes.size();
+        std::vector<std::vector<uint32_t>> successors(pass_count);
+        //passes whose output this pass consumes, the edges culling walks back along
+        std::vector<std::vector<uint32_t>> producers(pass_count);
+        std::vector<uint32_t> last_writer(resources.size(), UINT32_MAX);
+        std::vector<std::vector<uint32_t>> readers(resources.size());
+
+        auto add_edge = [&](uint32_t from, uint32_t to, bool producer) {
+            if (from == UINT32_MAX || from == to) {
+                return;
+            }
+            if (std::find(successors[from].begin(), successors[from].end(), to) == successors[from].end()) {
+                successors[from].push_back(to);
+            }
+            if (producer && std::find(producers[to].begin(), producers[to].end(), from) == producers[to].end()) {
+                producers[to].push_back(from);
+            }
+        };
+
+        //hazards follow declaration order: read after write, write after write and write after read.
+        for (uint32_t pass = 0; pass < pass_count; ++pass) {
+            for (auto& use : passes[pass].uses) {
+                if (get_access_info(use).write) {
+                    //a cleared attachment does not depend on what was written before
+                    add_edge(last_writer[use.resource], pass, !use.clear);
+                    for (auto reader : readers[use.resource]) {
+                        add_edge(reader, pass, false);
+                    }
+                } else {
+                    add_edge(last_writer[use.resource], pass, true);
+                }
+            }
+            for (auto& use : passes[pass].uses) {
+                if (!get_access_info(use).write) {
+                    readers[use.resource].push_back(pass);
+                }
+            }
+            for (auto& use : passes[pass].uses) {
+                if (get_access_info(use).write) {
+                    last_writer[use.resource] = pass;
+                    readers[use.resource].clear();
+                }
+            }
+        }
+
+        //a pass survives if it writes an imported resource, has side effects, or feeds a pass that survives.
+        std::vector<bool> alive(pass_count, false);
+        std::vector<uint32_t> stack;
+        for (uint32_t pass = 0; pass < pass_count; ++pass) {
+            bool seed = passes[pass].side_effects;
+            for (auto& use : passes[pass].uses) {
+                seed |= get_access_info(use).write && resources[use.resource].imported;
+            }
+            if (seed) {
+                alive[pass] = true;
+                stack.push_back(pass);
+            }
+        }
+        while (!stack.empty()) {
+            uint32_t pass = stack.back();
+            stack.pop_back();
+            for (auto producer : producers[pass]) {
+                if (!alive[producer]) {
+                    alive[producer] = true;
+                    stack.push_back(producer);
+                }
+            }
+        }
+
+        //kahn, ties go to the earliest declared pass so independent passes keep the order they were written in.
+        std::vector<uint32_t> in_degree(pass_count, 0);
+        for (uint32_t pass = 0; pass < pass_count; ++pass) {
+            if (!alive[pass]) {
+                continue;
+            }
+            for (auto successor : successors[pass]) {
+                if (alive[successor]) {
+                    in_degree[successor]++;
+                }
+            }
+        }
+
+        std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> ready;
+        for (uint32_t pass = 0; pass < pass_count; ++pass) {
+            if (alive[pass] && in_degree[pass] == 0) {
+                ready.push(pass);
+            }
+        }
+
+        std::vector<uint32_t> order;
+        while (!ready.empty()) {
+            uint32_t pass = ready.top();
+            ready.pop();
+            order.push_back(pass);
+            for (auto successor : successors[pass]) {
+                if (alive[successor] && --in_degree[successor] == 0) {
+                    ready.push(successor);
+                }
+            }
+        }
+        return order;
+    }
+
+    static VkImageCreateInfo get_image_info(VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkSampleCountFlagBits samples) {
+        VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = format;
+        image_info.extent = extent;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = samples;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = usage;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        return image_info;
+    }
+
+    static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void RenderGraph::assign_physical_images() {
+        release_unused();
+
+        for (auto& physical_image : physical_images) {
+            physical_image.taken = false;
+        }
+
+        std::vector<uint32_t> transients;
+        for (uint32_t index = 0; index < resources.size(); ++index) {
+            if (!resources[index].imported && resources[index].first_use != UINT32_MAX) {
+                transients.push_back(index);
+            }
+        }
+        stats.transient_image_count = transients.size();
+
+        glm::ivec2 backbuffer_extent = context->get_extent();
+        for (auto index : transients) {
+            Resource& resource = resources[index];
+            glm::uvec2 size = resource.desc.size == glm::uvec2{0, 0} ? glm::uvec2(backbuffer_extent) : resource.desc.size;
+
+            //only ever an attachment of a single pass, never loaded or stored, so it can live in tile memory.
+            resource.tile_local = resource.first_use == resource.last_use &&
+                                  (resource.usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) == 0;
+            resource.physical = acquire_physical_image(resource, {size.x, size.y, 1});
+        }
+
+        alias_memory(transients);
+
+        for (auto index : transients) {
+            resources[index].image = physical_images[resources[index].physical].image;
+        }
+    }
+
+    uint32_t RenderGraph::acquire_physical_image(const Resource& resource, VkExtent3D extent) {
+        VkImageUsageFlags usage = resource.usage | (resource.tile_local ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+
+        for (uint32_t index = 0; index < physical_images.size(); ++index) {
+            PhysicalImage& candidate = physical_images[index];
+            if (!candidate.taken && candidate.format == resource.desc.format && candidate.samples == resource.desc.samples &&
+                candidate.usage == usage && candidate.extent.width == extent.width && candidate.extent.height == extent.height) {
+                candidate.taken = true;
+                candidate.last_used_frame = context->get_frame_number();
+                return index;
+            }
+        }
+
+        PhysicalImage physical_image{};
+        physical_image.format = resource.desc.format;
+        physical_image.extent = extent;
+        physical_image.samples = resource.desc.samples;
+        physical_image.usage = usage;
+        physical_image.taken = true;
+        physical_image.last_used_frame = context->get_frame_number();
+
+        VkImageCreateInfo image_info = get_image_info(physical_image.format, extent, usage, physical_image.samples);
+
+        if (resource.tile_local) {
+            VmaAllocationCreateInfo alloc_info{};
+            alloc_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+            uint32_t memory_type_index = 0;
+            if (vmaFindMemoryTypeIndexForImageInfo(context->get_allocator(), &image_info, &alloc_info, &memory_type_index) == VK_SUCCESS) {
+                physical_image.image = context->create_image(physical_image.format, extent, usage, physical_image.samples,
+                                                             VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED);
+                physical_image.lazy = physical_image.image.image != VK_NULL_HANDLE;
+                physical_image.dedicated = physical_image.lazy;
+            }
+        }
+
+        //everything else is created unbound and placed in an aliasing heap.
+        if (!physical_image.dedicated) {
+            physical_image.image.image_format = physical_image.format;
+            physical_image.image.extent = extent;
+            physical_image.image.usage = usage;
+            vkCreateImage(context->get_device(), &image_info, nullptr, &physical_image.image.image);
+            vkGetImageMemoryRequirements(context->get_device(), physical_image.image.image, &physical_image.requirements);
+        }
+
+        physical_images.push_back(physical_image);
+        return physical_images.size() - 1;
+    }
+
+    void RenderGraph::alias_memory(const std::vector<uint32_t>& transients) {
+        struct HeapGroup {
+            uint32_t memory_type_bits;
+            VkDeviceSize alignment;
+            VkDeviceSize size;
+            std::vector<uint32_t> members;
+        };
+
+        std::vector<uint32_t> aliased;
+        for (auto index : transients) {
+            Resource& resource = resources[index];
+            resource.heap = UINT32_MAX;
+            resource.aliased.clear();
+            const PhysicalImage& physical_image = physical_images[resource.physical];
+            if (physical_image.dedicated) {
+                stats.lazy_image_count += physical_image.lazy ? 1 : 0;
+            } else {
+                aliased.push_back(index);
+            }
+        }
+
+        //largest first packs tighter, each image takes the lowest offset free of everything alive alongside it.
+        std::sort(aliased.begin(), aliased.end(), [this](uint32_t a, uint32_t b) {
+            VkDeviceSize size_a = physical_images[resources[a].physical].requirements.size;
+            VkDeviceSize size_b = physical_images[resources[b].physical].requirements.size;
+            return size_a != size_b ? size_a > size_b : resources[a].first_use < resources[b].first_use;
+        });
+
+        std::vector<HeapGroup> groups;
+        for (auto index : aliased) {
+            Resource& resource = resources[index];
+            const VkMemoryRequirements& requirements = physical_images[resource.physical].requirements;
+            stats.transient_memory_size += requirements.size;
+
+            HeapGroup* group = nullptr;
+            for (auto& candidate : groups) {
+                if (candidate.memory_type_bits == requirements.memoryTypeBits) {
+                    group = &candidate;
+                    break;
+                }
+            }
+            if (group == nullptr) {
+                groups.push_back({requirements.memoryTypeBits, 1, 0});
+                group = &groups.back();
+            }
+
+            VkDeviceSize offset = 0;
+            bool moved = true;
+            while (moved) {
+                moved = false;
+                for (auto member : group->members) {
+                    Resource& other = resources[member];
+                    VkDeviceSize other_size = physical_images[other.physical].requirements.size;
+                    bool lifetimes_overlap = other.first_use <= resource.last_use && resource.first_use <= other.last_use;
+                    bool ranges_overlap = other.offset < offset + requirements.size && offset < other.offset + other_size;
+                    if (lifetimes_overlap && ranges_overlap) {
+                        offset = align_up(other.offset + other_size, requirements.alignment);
+                        moved = true;
+                    }
+                }
+            }
+
+            resource.offset = offset;
+            resource.heap = group - groups.data();
+            group->alignment = std::max(group->alignment, requirements.alignment);
+            group->size = std::max(group->size, offset + requirements.size);
+            group->members.push_back(index);
+        }
+
+        std::vector<bool> heap_taken(heaps.size(), false);
+        for (auto& group : groups) {
+            uint32_t heap_index = UINT32_MAX;
+            for (uint32_t index = 0; index < heaps.size(); ++index) {
+                if (!heap_taken[index] && heaps[index].memory_type_bits == group.memory_type_bits) {
+                    heap_index = index;
+                    break;
+                }
+            }
+            if (heap_index == UINT32_MAX) {
+                heaps.push_back({group.memory_type_bits});
+                heap_taken.push_back(false);
+                heap_index = heaps.size() - 1;
+            }
+
+            MemoryHeap& heap = heaps[heap_index];
+            if (heap.size < group.size) {
+                //grown heaps are reallocated, the images placed in the old one are recreated on their next bind.
+                if (heap.allocation != VK_NULL_HANDLE) {
+                    release_heap_images(heap.allocation);
+                    context->destroy_deferred(heap.allocation);
+                }
+
+                VkMemoryRequirements requirements{group.size, group.alignment, group.memory_type_bits};
+                VmaAllocationCreateInfo alloc_info{};
+                alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+                heap.size = 0;
+                if (vmaAllocateMemory(context->get_allocator(), &requirements, &alloc_info, &heap.allocation, nullptr) != VK_SUCCESS) {
+                    spdlog::error("[RenderGraph] failed to allocate {} bytes of transient memory, falling back to dedicated images", group.size);
+                    heap.allocation = VK_NULL_HANDLE;
+                    for (auto member : group.members) {
+                        resources[member].heap = UINT32_MAX;
+                        resources[member].aliased.clear();
+                        make_dedicated(physical_images[resources[member].physical]);
+                    }
+                    continue;
+                }
+                heap.size = group.size;
+            }
+            heap_taken[heap_index] = true;
+            heap.last_used_frame = context->get_frame_number();
+            stats.aliased_memory_size += heap.size;
+
+            for (auto member : group.members) {
+                Resource& resource = resources[member];
+                resource.heap = heap_index;
+                VkDeviceSize size = physical_images[resource.physical].requirements.size;
+                for (auto other_index : group.members) {
+                    Resource& other = resources[other_index];
+                    VkDeviceSize other_size = physical_images[other.physical].requirements.size;
+                    if (other.last_use < resource.first_use &&
+                        other.offset < resource.offset + size && resource.offset < other.offset + other_size) {
+                        resource.aliased.push_back(other_index);
+                    }
+                }
+
+                PhysicalImage& physical_image = physical_images[resource.physical];
+                if (physical_image.bound_allocation != heap.allocation || physical_image.bound_offset != resource.offset) {
+                    bind_physical_image(physical_image, heap, resource.offset);
+                }
+            }
+        }
+    }
+
+    void RenderGraph::make_dedicated(PhysicalImage& physical_image) {
+        //the unbound (or previously bound) image is replaced by one with its own allocation, it is never aliased again.
+        if (physical_image.image.image != VK_NULL_HANDLE) {
+            context->destroy_deferred(physical_image.image);
+        }
+        physical_image.image = context->create_image(physical_image.format, physical_image.extent, physical_image.usage, physical_image.samples);
+        physical_image.dedicated = true;
+        physical_image.bound_allocation = VK_NULL_HANDLE;
+        physical_image.bound_offset = 0;
+    }
+
+    void RenderGraph::bind_physical_image(PhysicalImage& physical_image, const MemoryHeap& heap, VkDeviceSize offset) {
+        VkDevice device = context->get_device();
+
+        //an image binds to memory once, moving it means a new handle.
+        if (physical_image.bound_allocation != VK_NULL_HANDLE || physical_image.image.image == VK_NULL_HANDLE) {
+            if (physical_image.image.image != VK_NULL_HANDLE) {
+                context->destroy_deferred(physical_image.image);
+            }
+            VkImageCreateInfo image_info = get_image_info(physical_image.format, physical_image.extent, physical_image.usage, physical_image.samples);
+            physical_image.image.image_view = VK_NULL_HANDLE;
+            vkCreateImage(device, &image_info, nullptr, &physical_image.image.image);
+        }
+
+        vmaBindImageMemory2(context->get_allocator(), heap.allocation, offset, physical_image.image.image, nullptr);
+        physical_image.bound_allocation = heap.allocation;
+        physical_image.bound_offset = offset;
+
+        VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        view_info.image = physical_image.image.image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = physical_image.format;
+        view_info.subresourceRange.aspectMask = get_format_aspect(physical_image.format);
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.layerCount = 1;
+        vkCreateImageView(device, &view_info, nullptr, &physical_image.image.image_view);
+    }
+
+    void RenderGraph::release_heap_images(VmaAllocation allocation) {
+        for (auto& physical_image : physical_images) {
+            if (physical_image.bound_allocation == allocation) {
+                context->destroy_deferred(physical_image.image);
+                physical_image.image.image = VK_NULL_HANDLE;
+                physical_image.image.image_view = VK_NULL_HANDLE;
+                physical_image.bound_allocation = VK_NULL_HANDLE;
+                physical_image.bound_offset = 0;
+            }
+        }
+    }
+
+    void RenderGraph::build_render_pass(CompiledPass& compiled, uint32_t position) {
+        RenderPassKey key{};
+        const RenderResourceUse* depth_use = nullptr;
+
+        auto add_attachment = [&](const RenderResourceUse& use) {
+            Resource& resource = resources[use.resource];
+            RenderAccessInfo info = get_access_info(use);
+            bool undefined = resource.first_use == position && (!resource.imported || resource.state.layout == VK_IMAGE_LAYOUT_UNDEFINED);
+            bool needed_later = resource.imported || resource.last_use > position;
+
+            VkAttachmentDescription attachment{};
+            attachment.format = resource.image.image_format;
+            attachment.samples = resource.desc.samples;
+            attachment.loadOp = use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : undefined ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD;
+            attachment.storeOp = needed_later ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            if (get_format_aspect(attachment.format) & VK_IMAGE_ASPECT_STENCIL_BIT) {
+                attachment.stencilLoadOp = attachment.loadOp;
+                attachment.stencilStoreOp = attachment.storeOp;
+            } else {
+                attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+            //layouts are transitioned by the graph's barriers, the render pass itself never changes them.
+            attachment.initialLayout = info.layout;
+            attachment.finalLayout = info.layout;
+
+            key.attachments.push_back(attachment);
+            compiled.attachments.push_back(use.resource);
+            compiled.clear_values.push_back(use.clear_value);
+            compiled.extent = {resource.image.extent.width, resource.image.extent.height};
+        };
+
+        for (auto& use : passes[compiled.pass].uses) {
+            if (use.access == RenderAccess::color_attachment) {
+                add_attachment(use);
+                key.color_count++;
+            } else if (use.access == RenderAccess::depth_attachment || use.access == RenderAccess::depth_read) {
+                depth_use = &use;
+            }
+        }
+        if (depth_use != nullptr) {
+            add_attachment(*depth_use);
+            key.has_depth = true;
+        }
+        if (key.attachments.empty()) {
+            return;
+        }
+
+        auto it = render_passes.find(key);
+        if (it != render_passes.end()) {
+            compiled.render_pass = it->second;
+            return;
+        }
+
+        std::vector<VkAttachmentReference> color_references;
+        for (uint32_t i = 0; i < key.color_count; ++i) {
+            color_references.push_back({i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+        }
+        VkAttachmentReference depth_reference{key.color_count, key.attachments.back().initialLayout};
+
+        VkSubpassDescription sub_pass{};
+        sub_pass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        sub_pass.colorAttachmentCount = color_references.size();
+        sub_pass.pColorAttachments = color_references.data();
+        sub_pass.pDepthStencilAttachment = key.has_depth ? &depth_reference : nullptr;
+
+        VkRenderPassCreateInfo render_pass_info{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+        render_pass_info.attachmentCount = key.attachments.size();
+        render_pass_info.pAttachments = key.attachments.data();
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &sub_pass;
+
+        if (vkCreateRenderPass(context->get_device(), &render_pass_info, nullptr, &compiled.render_pass) != VK_SUCCESS) {
+            spdlog::error("[RenderGraph] failed to create render pass for {}", passes[compiled.pass].name);
+            return;
+        }
+        render_passes.emplace(std::move(key), compiled.render_pass);
+    }
+
+    VkFramebuffer RenderGraph::get_framebuffer(const CompiledPass& compiled, bool imageless) {
+        //imageless framebuffers are shared by every set of views with the same usage, the backbuffer included.
+        FramebufferKey key{};
+        key.render_pass = compiled.render_pass;
+        key.extent = compiled.extent;
+        for (auto attachment : compiled.attachments) {
+            if (imageless) {
+                key.usages.push_back(resources[attachment].image.usage);
+            } else {
+                key.attachments.push_back(resources[attachment].image.image_view);
+            }
+        }
+
+        auto it = framebuffers.find(key);
+        if (it != framebuffers.end()) {
+            it->second.last_used_frame = context->get_frame_number();
+            return it->second.framebuffer;
+        }
+
+        std::vector<VulkanImage> attachments;
+        for (auto attachment : compiled.attachments) {
+            attachments.push_back(resources[attachment].image);
+        }
+
+        VkFramebuffer framebuffer = context->create_framebuffer(compiled.render_pass, attachments, compiled.extent, imageless);
+        framebuffers.emplace(std::move(key), CachedFramebuffer{framebuffer, context->get_frame_number()});
+        return framebuffer;
+    }
+
+    void RenderGraph::release_unused() {
+        uint64_t frame_number = context->get_frame_number();
+
+        for (size_t index = 0; index < heaps.size();) {
+            if (frame_number - heaps[index].last_used_frame > UNUSED_RELEASE_FRAMES) {
+                release_heap_images(heaps[index].allocation);
+                context->destroy_deferred(heaps[index].allocation);
+                heaps.erase(heaps.begin() + index);
+            } else {
+                ++index;
+            }
+        }
+
+        for (size_t index = 0; index < physical_images.size();) {
+            if (frame_number - physical_images[index].last_used_frame > UNUSED_RELEASE_FRAMES) {
+                if (physical_images[index].image.image != VK_NULL_HANDLE) {
+                    context->destroy_deferred(physical_images[index].image);
+                }
+                physical_images.erase(physical_images.begin() + index);
+            } else {
+                ++index;
+            }
+        }
+
+        for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+            if (frame_number - it->second.last_used_frame > UNUSED_RELEASE_FRAMES) {
+                context->destroy_deferred(it->second.framebuffer);
+                it = framebuffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void RenderGraph::transition(Resource& resource, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access, bool write,
+                                 VkPipelineStageFlags& src_stages, VkPipelineStageFlags& dst_stages) {
+        ResourceState& state = resource.physical != UINT32_MAX ? physical_images[resource.physical].state : resource.state;
+        bool layout_change = !resource.is_buffer && state.layout != layout;
+
+        //reads after reads never wait, reads wait only on a write not yet visible to their stages.
+        VkPipelineStageFlags wait_stages = 0;
+        bool barrier = false;
+        if (layout_change || write) {
+            wait_stages = state.write_stages | state.read_stages;
+            barrier = layout_change || wait_stages != 0;
+        } else if (state.write_stages != 0 && (stages & ~state.visible_stages) != 0) {
+            wait_stages = state.write_stages;
+            barrier = true;
+        }
+
+        if (barrier) {
+            src_stages |= wait_stages != 0 ? wait_stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+            dst_stages |= stages;
+
+            if (resource.is_buffer) {
+                VkBufferMemoryBarrier buffer_barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+                buffer_barrier.srcAccessMask = state.write_access;
+                buffer_barrier.dstAccessMask = access;
+                buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                buffer_barrier.buffer = resource.buffer;
+                buffer_barrier.size = VK_WHOLE_SIZE;
+                buffer_barriers.push_back(buffer_barrier);
+            } else {
+                VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+                image_barrier.srcAccessMask = state.write_access;
+                image_barrier.dstAccessMask = access;
+                image_barrier.oldLayout = state.layout;
+                image_barrier.newLayout = layout;
+                image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                image_barrier.image = resource.image.image;
+                image_barrier.subresourceRange.aspectMask = get_format_aspect(resource.image.image_format);
+                image_barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                image_barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                image_barriers.push_back(image_barrier);
+            }
+        }
+
+        if (write) {
+            state.write_stages = stages;
+            state.write_access = access;
+            state.visible_stages = 0;
+            state.read_stages = 0;
+        } else if (layout_change) {
+            //the transition itself is a write, later readers in other stages still have to wait on it.
+            state.write_stages = stages;
+            state.write_access = 0;
+            state.visible_stages = stages;
+            state.read_stages = stages;
+        } else {
+            if (barrier) {
+                state.visible_stages |= stages;
+            }
+            state.read_stages |= stages;
+        }
+        if (!resource.is_buffer) {
+            state.layout = layout;
+        }
+    }
+
+    void RenderGraph::execute() {
+        VkCommandBuffer command_buffer = context->get_frame_command_buffer();
+        bool backbuffer_written = false;
+
+        for (uint32_t position = 0; position < compiled_passes.size(); ++position) {
+            CompiledPass& compiled = compiled_passes[position];
+            RenderGraphPass& pass = passes[compiled.pass];
+
+            //a transient's previous contents, and the previous frame's, are never read back.
+            for (auto& use : pass.uses) {
+                Resource& resource = resources[use.resource];
+                if (resource.imported || resource.first_use != position) {
+                    continue;
+                }
+                ResourceState& state = physical_images[resource.physical].state;
+                state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                if (resource.heap != UINT32_MAX) {
+                    //the memory was last touched by the images aliasing it, this frame or the previous one.
+                    ResourceState aliased_state{};
+                    aliased_state.write_stages = heaps[resource.heap].frame_stages;
+                    aliased_state.write_access = heaps[resource.heap].frame_access;
+                    for (auto other : resource.aliased) {
+                        ResourceState& other_state = physical_images[resources[other].physical].state;
+                        aliased_state.write_stages |= other_state.write_stages | other_state.read_stages;
+                        aliased_state.write_access |= other_state.write_access;
+                    }
+                    state = aliased_state;
+                }
+            }
+
+            image_barriers.clear();
+            buffer_barriers.clear();
+            VkPipelineStageFlags src_stages = 0;
+            VkPipelineStageFlags dst_stages = 0;
+            for (auto& use : pass.uses) {
+                Resource& resource = resources[use.resource];
+                RenderAccessInfo info = get_access_info(use);
+                transition(resource, info.layout, info.stages, info.access, info.write, src_stages, dst_stages);
+                backbuffer_written |= resource.backbuffer && info.write;
+            }
+
+            if (!image_barriers.empty() || !buffer_barriers.empty()) {
+                vkCmdPipelineBarrier(command_buffer, src_stages, dst_stages, 0, 0, nullptr,
+                                     buffer_barriers.size(), buffer_barriers.data(),
+                                     image_barriers.size(), image_barriers.data());
+                stats.barrier_count += image_barriers.size() + buffer_barriers.size();
+            }
+
+            GpuProfiler::Scope gpu_scope(context->get_gpu_profiler(), command_buffer, pass.name);
+            if (compiled.render_pass == VK_NULL_HANDLE) {
+                if (pass.execute) {
+                    pass.execute(command_buffer);
+                }
+                continue;
+            }
+
+            //imported images of unknown usage cannot be described to an imageless framebuffer.
+            bool imageless = context->uses_imageless_framebuffers();
+            for (auto attachment : compiled.attachments) {
+                imageless &= resources[attachment].image.usage != 0;
+            }
+
+            VkRenderPassBeginInfo render_pass_info{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+            render_pass_info.renderPass = compiled.render_pass;
+            render_pass_info.framebuffer = get_framebuffer(compiled, imageless);
+            render_pass_info.renderArea.extent = compiled.extent;
+            render_pass_info.clearValueCount = compiled.clear_values.size();
+            render_pass_info.pClearValues = compiled.clear_values.data();
+
+            VkRenderPassAttachmentBeginInfo attachment_begin_info{VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO};
+            if (imageless) {
+                attachment_views.clear();
+                for (auto attachment : compiled.attachments) {
+                    attachment_views.push_back(resources[attachment].image.image_view);
+                }
+                attachment_begin_info.attachmentCount = attachment_views.size();
+                attachment_begin_info.pAttachments = attachment_views.data();
+                render_pass_info.pNext = &attachment_begin_info;
+            }
+            vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+            //same flipped viewport as the swapchain pass.
+            VkViewport viewport{};
+            viewport.y = static_cast<float>(compiled.extent.height);
+            viewport.width = static_cast<float>(compiled.extent.width);
+            viewport.height = -static_cast<float>(compiled.extent.height);
+            viewport.maxDepth = 1.f;
+            vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+            VkRect2D scissor{{0, 0}, compiled.extent};
+            vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+            if (pass.execute) {
+                pass.execute(command_buffer);
+            }
+            vkCmdEndRenderPass(command_buffer);
+        }
+
+        //imported images leave the graph in the layout their owner expects.
+        image_barriers.clear();
+        VkPipelineStageFlags src_stages = 0;
+        for (auto& resource : resources) {
+            if (!resource.imported || resource.is_buffer || resource.first_use == UINT32_MAX ||
+                resource.final_layout == VK_IMAGE_LAYOUT_UNDEFINED || resource.final_layout == resource.state.layout) {
+                continue;
+            }
+            VkPipelineStageFlags dst_stages = 0;
+            transition(resource, resource.final_layout, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, false, src_stages, dst_stages);
+        }
+        if (!image_barriers.empty()) {
+            vkCmdPipelineBarrier(command_buffer, src_stages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+                                 image_barriers.size(), image_barriers.data());
+            stats.barrier_count += image_barriers.size();
+        }
+
+        //heaps idle this frame keep what they last did, the frame that next uses them still has to wait on it.
+        for (auto& heap : heaps) {
+            if (heap.last_used_frame == context->get_frame_number()) {
+                heap.frame_stages = 0;
+                heap.frame_access = 0;
+            }
+        }
+        for (auto& resource : resources) {
+            if (resource.heap != UINT32_MAX && resource.first_use != UINT32_MAX) {
+                ResourceState& state = physical_images[resource.physical].state;
+                heaps[resource.heap].frame_stages |= state.write_stages | state.read_stages;
+                heaps[resource.heap].frame_access |= state.write_access;
+            }
+        }
+
+        if (backbuffer_written) {
+            context->mark_backbuffer_written();
+        }
+    }
+
+}
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "volk.h"
+#include "vk_mem_alloc.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "vulkan_types.hpp"
+
+namespace vk_sandbox {
+
+    class VulkanContext;
+
+    using RenderResource = uint32_t;
+    constexpr RenderResource INVALID_RENDER_RESOURCE = UINT32_MAX;
+
+    //size {0, 0} follows the backbuffer extent.
+    struct RenderImageDesc {
+        VkFormat format{VK_FORMAT_R8G8B8A8_UNORM};
+        glm::uvec2 size{0, 0};
+        VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+    };
+
+    enum class RenderAccess {
+        color_attachment,
+        depth_attachment,
+        //bound as a read-only depth attachment
+        depth_read,
+        sampled,
+        storage_read,
+        storage_write
+    };
+
+    struct RenderResourceUse {
+        RenderResource resource{INVALID_RENDER_RESOURCE};
+        RenderAccess access{};
+        //shader stages for sampled and storage accesses, attachments imply their own
+        VkPipelineStageFlags stages{};
+        bool clear{false};
+        VkClearValue clear_value{};
+    };
+
+    struct RenderGraphPass {
+        std::string name;
+        std::vector<RenderResourceUse> uses;
+        bool side_effects{false};
+        std::function<void(VkCommandBuffer)> execute;
+
+        RenderGraphPass& write_color(RenderResource image, std::optional<VkClearColorValue> clear = std::nullopt);
+        RenderGraphPass& write_depth(RenderResource image, std::optional<VkClearDepthStencilValue> clear = std::nullopt);
+        RenderGraphPass& read_depth(RenderResource image);
+        RenderGraphPass& read_texture(RenderResource image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        RenderGraphPass& read_storage(RenderResource resource, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        RenderGraphPass& write_storage(RenderResource resource, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        //passes writing nothing the frame consumes are culled, unless their work is observed elsewhere (readbacks, queries).
+        RenderGraphPass& set_side_effects();
+        RenderGraphPass& set_execute(std::function<void(VkCommandBuffer)> execute);
+    };
+
+    struct RenderGraphStats {
+        uint32_t pass_count{};
+        uint32_t culled_pass_count{};
+        uint32_t barrier_count{};
+        uint32_t transient_image_count{};
+        //attachments living entirely in one pass, backed by lazily allocated memory when the device has it
+        uint32_t lazy_image_count{};
+        //bytes the transients would need unaliased, and what the aliasing heaps actually hold
+        VkDeviceSize transient_memory_size{};
+        VkDeviceSize aliased_memory_size{};
+    };
+
+    //rebuilt every frame: declare resources and passes, compile, execute between begin_frame and end_frame.
+    //render passes, framebuffers and transient images persist across rebuilds and are reused by description.
+    class RenderGraph {
+    public:
+        void init(VulkanContext* context);
+        void destroy();
+
+        void reset();
+        RenderResource create_image(const std::string& name, const RenderImageDesc& desc);
+        RenderResource import_image(const std::string& name, const VulkanImage& image,
+                                    VkImageLayout initial_layout, VkImageLayout final_layout);
+        RenderResource import_buffer(const std::string& name, const VulkanBuffer& buffer);
+        RenderResource import_backbuffer();
+        RenderGraphPass& add_pass(const std::string& name);
+
+        void compile();
+        void execute();
+
+        const VulkanImage& get_image(RenderResource image) const { return resources[image].image; }
+        //valid after compile, pipelines drawn in the pass are built against it.
+        VkRenderPass get_render_pass(const std::string& pass_name) const;
+        const RenderGraphStats& get_stats() const { return stats; }
+    private:
+        struct ResourceState {
+            VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+            //stages of the last write, or of the last layout transition
+            VkPipelineStageFlags write_stages{};
+            VkAccessFlags write_access{};
+            //stages the last write has been made visible to
+            VkPipelineStageFlags visible_stages{};
+            //stages reading since the last write
+            VkPipelineStageFlags read_stages{};
+        };
+
+        struct Resource {
+            std::string name;
+            bool imported{false};
+            bool is_buffer{false};
+            bool backbuffer{false};
+            RenderImageDesc desc{};
+            VulkanImage image{};
+            VkBuffer buffer{};
+            VkImageLayout final_layout{VK_IMAGE_LAYOUT_UNDEFINED};
+            ResourceState state{};
+            VkImageUsageFlags usage{};
+            uint32_t physical{UINT32_MAX};
+            uint32_t first_use{UINT32_MAX};
+            uint32_t last_use{0};
+            bool tile_local{false};
+            //aliasing heap and offset this frame, UINT32_MAX for dedicated images
+            uint32_t heap{UINT32_MAX};
+            VkDeviceSize offset{};
+            //earlier transients of this frame sharing its memory, its first use waits on them
+            std::vector<RenderResource> aliased;
+        };
+
+        struct PhysicalImage {
+            VkFormat format{};
+            VkExtent3D extent{};
+            VkSampleCountFlagBits samples{};
+            VkImageUsageFlags usage{};
+            //allocation is only set for dedicated images: lazily allocated ones, or aliased ones whose heap failed to allocate
+            VulkanImage image{};
+            bool lazy{false};
+            bool dedicated{false};
+            VkMemoryRequirements requirements{};
+            //where an aliased image is bound, a different placement needs a new image
+            VmaAllocation bound_allocation{};
+            VkDeviceSize bound_offset{};
+            //carried across frames so the first barrier of a frame orders against the previous frame's last use
+            ResourceState state{};
+            uint64_t last_used_frame{};
+            bool taken{false};
+        };
+
+        struct MemoryHeap {
+            uint32_t memory_type_bits{};
+            VmaAllocation allocation{};
+            VkDeviceSize size{};
+            //everything the images in the heap did last frame, the next frame's first users wait on it
+            VkPipelineStageFlags frame_stages{};
+            VkAccessFlags frame_access{};
+            uint64_t last_used_frame{};
+        };
+
+        struct RenderPassKey {
+            std::vector<VkAttachmentDescription> attachments;
+            uint32_t color_count{};
+            bool has_depth{false};
+
+            bool operator==(const RenderPassKey& other) const;
+            size_t hash() const;
+        };
+
+        struct FramebufferKey {
+            VkRenderPass render_pass{};
+            //views for regular framebuffers, usages for imageless ones
+            std::vector<VkImageView> attachments;
+            std::vector<VkImageUsageFlags> usages;
+            VkExtent2D extent{};
+
+            bool operator==(const FramebufferKey& other) const;
+            size_t hash() const;
+        };
+
+        struct CachedFramebuffer {
+            VkFramebuffer framebuffer{};
+            uint64_t last_used_frame{};
+        };
+
+        template<typename T>
+        struct KeyHash {
+            size_t operator()(const T& key) const { return key.hash(); }
+        };
+
+        struct CompiledPass {
+            uint32_t pass{};
+            VkRenderPass render_pass{};
+            std::vector<RenderResource> attachments;
+            std::vector<VkClearValue> clear_values;
+            VkExtent2D extent{};
+        };
+
+        VulkanContext* context{};
+
+        std::vector<Resource> resources;
+        std::deque<RenderGraphPass> passes;
+        std::vector<CompiledPass> compiled_passes;
+        RenderGraphStats stats{};
+
+        std::vector<PhysicalImage> physical_images;
+        std::vector<MemoryHeap> heaps;
+        std::unordered_map<RenderPassKey, VkRenderPass, KeyHash<RenderPassKey>> render_passes;
+        std::unordered_map<FramebufferKey, CachedFramebuffer, KeyHash<FramebufferKey>> framebuffers;
+
+        //scratch, reused every compile and execute
+        std::vector<VkImageMemoryBarrier> image_barriers;
+        std::vector<VkBufferMemoryBarrier> buffer_barriers;
+        std::vector<VkImageView> attachment_views;
+
+        std::vector<uint32_t> sort_passes();
+        void assign_physical_images();
+        uint32_t acquire_physical_image(const Resource& resource, VkExtent3D extent);
+        void alias_memory(const std::vector<uint32_t>& transients);
+        void bind_physical_image(PhysicalImage& physical_image, const MemoryHeap& heap, VkDeviceSize offset);
+        void make_dedicated(PhysicalImage& physical_image);
+        void release_heap_images(VmaAllocation allocation);
+        void build_render_pass(CompiledPass& compiled, uint32_t position);
+        VkFramebuffer get_framebuffer(const CompiledPass& compiled, bool imageless);
+        void transition(Resource& resource, VkImageLayout layout, VkPipelineStageFlags stages, VkAccessFlags access, bool write,
+                        VkPipelineStageFlags& src_stages, VkPipelineStageFlags& dst_stages);
+        void release_unused();
+    };
+
+}
@@ -0,0 +1,88 @@
+#include "thread_pool.hpp"
+
+namespace vk_sandbox {
+
+    void ThreadPool::init(uint32_t worker_count) {
+        stopping = false;
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            workers.emplace_back(&ThreadPool::worker_loop, this, i + 1);
+        }
+    }
+
+    void ThreadPool::destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    void ThreadPool::parallel_for(uint32_t count, const std::function<void(uint32_t, uint32_t)>& batch_task) {
+        if (count == 0) {
+            return;
+        }
+        if (workers.empty() || count == 1) {
+            for (uint32_t index = 0; index < count; ++index) {
+                batch_task(index, 0);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &batch_task;
+            task_count = count;
+            next_index = 0;
+            generation++;
+        }
+        work_available.notify_all();
+
+        run_tasks(batch_task, count, 0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [this] { return active_workers == 0; });
+        task = nullptr;
+    }
+
+    void ThreadPool::run_tasks(const std::function<void(uint32_t, uint32_t)>& batch_task, uint32_t batch_count, uint32_t slot) {
+        while (true) {
+            uint32_t index = next_index.fetch_add(1);
+            if (index >= batch_count) {
+                return;
+            }
+            batch_task(index, slot);
+        }
+    }
+
+    void ThreadPool::worker_loop(uint32_t slot) {
+        uint64_t seen_generation = 0;
+        while (true) {
+            const std::function<void(uint32_t, uint32_t)>* batch_task;
+            uint32_t batch_count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [&] { return stopping || (generation != seen_generation && task != nullptr); });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+                batch_task = task;
+                batch_count = task_count;
+                active_workers++;
+            }
+
+            run_tasks(*batch_task, batch_count, slot);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                active_workers--;
+            }
+            work_done.notify_one();
+        }
+    }
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace vk_sandbox {
+
+    //fork-join pool, the calling thread takes part in the work. Slot 0 is the caller, workers are 1..N,
+    //so per-thread resources can be indexed by slot without locking.
+    class ThreadPool {
+    public:
+        void init(uint32_t worker_count);
+        void destroy();
+
+        uint32_t get_slot_count() const { return workers.size() + 1; }
+
+        //runs task(index, slot) for every index in [0, count) and returns once all of them are done.
+        void parallel_for(uint32_t count, const std::function<void(uint32_t index, uint32_t slot)>& task);
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable work_available;
+        std::condition_variable work_done;
+        const std::function<void(uint32_t, uint32_t)>* task{};
+        uint32_t task_count{};
+        std::atomic<uint32_t> next_index{};
+        uint64_t generation{};
+        //workers still inside the current batch, the task must outlive all of them
+        uint32_t active_workers{};
+        bool stopping{false};
+
+        void worker_loop(uint32_t slot);
+        void run_tasks(const std::function<void(uint32_t, uint32_t)>& batch_task, uint32_t batch_count, uint32_t slot);
+    };
+
+}
@@ -1,5 +1,11 @@
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
 #include "vulkan_context.hpp"
+#include "hash.hpp"
+#include "cpu_profiler.hpp"
 
 #define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
 #define VMA_IMPLEMENTATION
@@ -7,6 +13,64 @@
 
 namespace vk_sandbox {
 
+    //keeps staged regions valid as bufferOffset for any texel size up to 16 bytes.
+    const VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+    //stages and accesses that may consume uploaded data in the frame.
+    const VkPipelineStageFlags UPLOAD_READ_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    const VkAccessFlags UPLOAD_READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                             VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    //on-disk pipeline cache, the blob is only reused on the exact same GPU and driver.
+    const uint32_t PIPELINE_CACHE_MAGIC = 0x43505356; // "VSPC"
+    const uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+    //stage_upload could not fit the data, the upload is dropped
+    const VkDeviceSize INVALID_STAGING_OFFSET = UINT64_MAX;
+
+    //returned by getters asked for an attachment a render target doesn't have
+    const VulkanImage NULL_IMAGE{};
+
+    struct PipelineCacheFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t cache_uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+        uint64_t checksum;
+    };
+
+    //flipped so +y points up, the swapchain pass and secondaries recorded for it share it.
+    static void set_viewport(VkCommandBuffer cmd, glm::ivec2 size) {
+        VkViewport vk_viewport;
+        vk_viewport.x = 0;
+        vk_viewport.y = size.y;
+        vk_viewport.width = size.x;
+        vk_viewport.height = -size.y;
+
+        vk_viewport.minDepth = 0.0f;
+        vk_viewport.maxDepth = 1.f;
+        vkCmdSetViewport(cmd, 0, 1, &vk_viewport);
+
+        VkRect2D rect_2d;
+        rect_2d.offset.x = 0;
+        rect_2d.offset.y = 0;
+        rect_2d.extent.width = static_cast<uint32_t>(size.x);
+        rect_2d.extent.height = static_cast<uint32_t>(size.y);
+        vkCmdSetScissor(cmd, 0, 1, &rect_2d);
+    }
+
+    static uint64_t fnv1a(const uint8_t* data, size_t size) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ data[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
     inline VkBool32 debug_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type,
                                    const VkDebugUtilsMessengerCallbackDataEXT* callback_data, void* p_user_data) {
         if (message_severity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
@@ -21,16 +85,23 @@ namespace vk_sandbox {
         return VK_FALSE;
     }
 
-    void VulkanContext::init_vulkan() {
+    void VulkanContext::init_vulkan(const VulkanContextSettings& context_settings) {
+        settings = context_settings;
+        settings.frames_in_flight = std::max(settings.frames_in_flight, 1u);
         volkInitialize();
 
         vkb::InstanceBuilder builder(vkGetInstanceProcAddr);
+        //timeline semaphores, descriptor indexing and imageless framebuffers are core in 1.2, the instance and device must expose it.
+        bool requires_vulkan_12 = settings.timeline_semaphores || settings.bindless || settings.imageless_framebuffers;
+        uint32_t minimum_minor_version = requires_vulkan_12 ? 2 : 1;
+
         auto inst_ret = builder.set_app_name("Vulkan Sandbox")
-                .require_api_version(1, 1)
+                .require_api_version(1, minimum_minor_version)
                 .desire_api_version(1, 2)
                 .request_validation_layers()
                 .use_default_debug_messenger()
                 .set_debug_callback(debug_callback)
+                .set_headless(settings.headless)
                 .build();
 
         instance_builder = inst_ret.value();
@@ -43,13 +114,33 @@ namespace vk_sandbox {
         VkPhysicalDeviceFeatures physical_device_features{};
         physical_device_features.samplerAnisotropy = VK_TRUE;
 
-        vkb::PhysicalDevice _physical_device = selector
-                .set_minimum_version(1, 1)
+        selector.set_minimum_version(1, minimum_minor_version)
                 .set_desired_version(1, 2)
                 .set_required_features(physical_device_features)
-                .defer_surface_initialization()
-                .select()
-                .value();
+                .require_present(!settings.headless)
+                .defer_surface_initialization();
+
+        VkPhysicalDeviceVulkan12Features physical_device_features_12{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+        if (settings.timeline_semaphores) {
+            physical_device_features_12.timelineSemaphore = VK_TRUE;
+        }
+        if (settings.bindless) {
+            physical_device_features_12.descriptorIndexing = VK_TRUE;
+            physical_device_features_12.runtimeDescriptorArray = VK_TRUE;
+            physical_device_features_12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            physical_device_features_12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+            physical_device_features_12.descriptorBindingPartiallyBound = VK_TRUE;
+            physical_device_features_12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            physical_device_features_12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        }
+        if (settings.imageless_framebuffers) {
+            physical_device_features_12.imagelessFramebuffer = VK_TRUE;
+        }
+        if (requires_vulkan_12) {
+            selector.set_required_features_12(physical_device_features_12);
+        }
+
+        vkb::PhysicalDevice _physical_device = selector.select().value();
 
         //create the final Vulkan device
         vkb::DeviceBuilder device_builder{_physical_device};
@@ -61,15 +152,52 @@ namespace vk_sandbox {
         graphics_queue = vkb_device.get_queue(vkb::QueueType::graphics).value();
         graphics_queue_family = vkb_device.get_queue_index(vkb::QueueType::graphics).value();
 
-        for (int i = 0; i < _physical_device.get_queue_families().size(); ++i) {
-            if (glfwGetPhysicalDevicePresentationSupport(instance, physical_device, i)) {
-                vkGetDeviceQueue(device, i, 0, &present_queue);
-                break;
+        //prefer a transfer-only family (DMA engine), then any non graphics family, then share the graphics queue.
+        auto dedicated_transfer_family = vkb_device.get_dedicated_queue_index(vkb::QueueType::transfer);
+        auto separate_transfer_family = vkb_device.get_queue_index(vkb::QueueType::transfer);
+
+        if (dedicated_transfer_family || separate_transfer_family) {
+            transfer_queue_family = dedicated_transfer_family ? dedicated_transfer_family.value() : separate_transfer_family.value();
+            vkGetDeviceQueue(device, transfer_queue_family, 0, &transfer_queue);
+            spdlog::info("[VulkanContext] uploads use dedicated transfer queue family {}", transfer_queue_family);
+        } else {
+            transfer_queue_family = graphics_queue_family;
+            transfer_queue = graphics_queue;
+        }
+
+        auto dedicated_compute_family = vkb_device.get_dedicated_queue_index(vkb::QueueType::compute);
+        auto separate_compute_family = vkb_device.get_queue_index(vkb::QueueType::compute);
+
+        if (dedicated_compute_family || separate_compute_family) {
+            compute_queue_family = dedicated_compute_family ? dedicated_compute_family.value() : separate_compute_family.value();
+            vkGetDeviceQueue(device, compute_queue_family, 0, &compute_queue);
+            spdlog::info("[VulkanContext] async compute uses queue family {}", compute_queue_family);
+        } else {
+            //still submitted separately, so the semaphore flow is the same, just without overlap.
+            compute_queue_family = graphics_queue_family;
+            compute_queue = graphics_queue;
+        }
+
+        if (settings.headless) {
+            //nothing is presented, the graphics queue is enough.
+            present_queue = graphics_queue;
+        } else {
+            for (int i = 0; i < _physical_device.get_queue_families().size(); ++i) {
+                if (glfwGetPhysicalDevicePresentationSupport(instance, physical_device, i)) {
+                    vkGetDeviceQueue(device, i, 0, &present_queue);
+                    break;
+                }
             }
         }
 
         vkGetPhysicalDeviceProperties(physical_device, &gpu_properties);
 
+        if (settings.timeline_semaphores) {
+            create_timelines();
+        }
+
+        load_pipeline_cache();
+
         VmaAllocatorCreateInfo allocatorInfo = {};
         allocatorInfo.physicalDevice = physical_device;
         allocatorInfo.device = device;
@@ -91,20 +219,27 @@ namespace vk_sandbox {
         vkAllocateCommandBuffers(device, &command_buffer_info, &temporary_command_buffer);
 
 
-        std::vector<VkDescriptorPoolSize> sizes = {
-                {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         100},
-                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100},
-                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         100}
-        };
+        //sets that live as long as their owner, pools are chained as they fill up.
+        descriptor_allocator.init(device);
+        descriptor_cache.init(device);
 
+        if (settings.bindless && !bindless_table.init(physical_device, device, settings.bindless_capacity)) {
+            spdlog::error("[VulkanContext] bindless resources disabled");
+            bindless_table.destroy();
+            settings.bindless = false;
+        }
 
-        VkDescriptorPoolCreateInfo pool_info{};
-        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        pool_info.poolSizeCount = sizes.size();
-        pool_info.pPoolSizes = sizes.data();
-        pool_info.maxSets = 100;
+        pipeline_state_cache.init(device, pipeline_cache, settings.pipeline_compile_threads);
+        recording_pool.init(settings.recording_threads);
 
-        vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool);
+        if (settings.gpu_profiling) {
+            uint32_t family_count = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+            std::vector<VkQueueFamilyProperties> families(family_count);
+            vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+            gpu_profiler.init(device, settings.frames_in_flight, gpu_properties.limits.timestampPeriod,
+                              families[graphics_queue_family].timestampValidBits, settings.gpu_profiler_max_regions);
+        }
 
 
         spdlog::info("[VulkanContext] Vulkan API {}.{}.{} Device: {} ",
@@ -116,52 +251,362 @@ namespace vk_sandbox {
 
     void VulkanContext::create_swapchain(GLFWwindow* window, bool vsync) {
         glfwCreateWindowSurface(instance, window, nullptr, &surface_khr);
+        this->vsync = vsync;
 
         glm::ivec2 framebuffer_size{};
         glfwGetFramebufferSize(window, &framebuffer_size.x, &framebuffer_size.y);
 
+        create_frames();
+        build_swapchain(framebuffer_size);
+
+        spdlog::info("[VulkanContext] swapchain created successfully");
+    }
+
+    bool VulkanContext::build_swapchain(glm::ivec2 size) {
         vkb::SwapchainBuilder swapchain_builder{physical_device, device, surface_khr};
-        vkb::Swapchain vkb_swapchain = swapchain_builder
+        auto swapchain_ret = swapchain_builder
+                .set_old_swapchain(swapchain_khr)
                 .set_desired_format({VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR})
                 .set_desired_present_mode(vsync ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_MAILBOX_KHR)
-                .set_desired_extent(framebuffer_size.x,framebuffer_size.y)
-                .build()
-                .value();
+                .set_desired_extent(size.x, size.y)
+                .set_image_usage_flags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
+                .build();
+
+        if (!swapchain_ret) {
+            spdlog::error("[VulkanContext] failed to create swapchain: {}", swapchain_ret.error().message());
+            return false;
+        }
+
+        vkb::Swapchain vkb_swapchain = swapchain_ret.value();
+
+        //frames already submitted may still render to or present the old images,
+        //so they are retired and destroyed once those frames are done instead of idling the device.
+        if (swapchain_khr != VK_NULL_HANDLE) {
+            for (auto framebuffer : swapchain_framebuffers) {
+                destroy_deferred(framebuffer);
+            }
+            for (auto& image : images) {
+                destroy_deferred(image.image_view);
+            }
+            defer_deletion(VK_OBJECT_TYPE_SWAPCHAIN_KHR, reinterpret_cast<uint64_t>(swapchain_khr));
+        }
+
+        VkFormat previous_format = images.empty() ? VK_FORMAT_UNDEFINED : images[0].image_format;
 
         swapchain_khr = vkb_swapchain.swapchain;
+        //the surface may clamp the extent, resizes are detected against what was asked for or it would rebuild every frame.
+        requested_extent = size;
+        extent = {static_cast<int>(vkb_swapchain.extent.width), static_cast<int>(vkb_swapchain.extent.height)};
         auto vkb_images = vkb_swapchain.get_images().value();
         auto vkb_image_views = vkb_swapchain.get_image_views().value();
 
-        images_in_flight.resize(vkb_images.size());
+        images_in_flight.assign(vkb_images.size(), VK_NULL_HANDLE);
+        images_in_flight_values.assign(vkb_images.size(), 0);
         images.resize(vkb_images.size());
 
         for (int i = 0; i < vkb_images.size(); ++i) {
             images[i].image_format = vkb_swapchain.image_format;
             images[i].image = vkb_images[i];
             images[i].image_view = vkb_image_views[i];
+            images[i].extent = {vkb_swapchain.extent.width, vkb_swapchain.extent.height, 1};
+            images[i].usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
         }
-        cmds.resize(vkb_images.size());
-        VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
-        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        alloc_info.commandPool = command_pool;
-        alloc_info.commandBufferCount = cmds.size();
-        vkAllocateCommandBuffers(device, &alloc_info, cmds.data());
+
+        //the surface format can change on recreation, e.g. when the window moves to another display.
+        if (swapchain_renderpass == VK_NULL_HANDLE || previous_format != vkb_swapchain.image_format) {
+            if (swapchain_renderpass != VK_NULL_HANDLE) {
+                destroy_deferred(swapchain_renderpass);
+            }
+            create_swapchain_renderpass(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        }
+        create_framebuffers();
+
+        swapchain_dirty = false;
+        return true;
+    }
+
+    void VulkanContext::create_headless(glm::ivec2 size) {
+        extent = size;
+
+        //one offscreen image per frame in flight, standing in for the swapchain images.
+        images_in_flight.resize(settings.frames_in_flight);
+        images_in_flight_values.resize(settings.frames_in_flight);
+        images.resize(settings.frames_in_flight);
+
+        for (auto& offscreen_image : images) {
+            offscreen_image.image_format = VK_FORMAT_B8G8R8A8_UNORM;
+            offscreen_image.extent = {static_cast<uint32_t>(size.x), static_cast<uint32_t>(size.y), 1};
+
+            VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+            image_info.imageType = VK_IMAGE_TYPE_2D;
+            image_info.format = offscreen_image.image_format;
+            image_info.extent = offscreen_image.extent;
+            image_info.mipLevels = 1;
+            image_info.arrayLayers = 1;
+            image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+            image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            offscreen_image.usage = image_info.usage;
+            image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            VmaAllocationCreateInfo alloc_info{};
+            alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+            vmaCreateImage(allocator, &image_info, &alloc_info, &offscreen_image.image, &offscreen_image.allocation, nullptr);
+
+            VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            view_info.image = offscreen_image.image;
+            view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            view_info.format = offscreen_image.image_format;
+            view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            view_info.subresourceRange.levelCount = 1;
+            view_info.subresourceRange.layerCount = 1;
+
+            vkCreateImageView(device, &view_info, nullptr, &offscreen_image.image_view);
+        }
+
+        create_frames();
+        create_swapchain_renderpass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        create_framebuffers();
+
+        spdlog::info("[VulkanContext] headless render targets created successfully {}x{}", size.x, size.y);
+    }
+
+    void VulkanContext::create_frames() {
+        VkCommandPoolCreateInfo command_pool_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        command_pool_info.queueFamilyIndex = graphics_queue_family;
+        command_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
         VkSemaphoreCreateInfo semaphore_info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
         VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
         fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
+        //each frame slot owns its pool, so resetting it never touches a buffer the GPU still reads.
+        frames.resize(settings.frames_in_flight);
+
+        for (auto& frame : frames) {
+            vkCreateCommandPool(device, &command_pool_info, nullptr, &frame.command_pool);
+
+            VkCommandBuffer command_buffers[2]{};
+            VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandPool = frame.command_pool;
+            alloc_info.commandBufferCount = 2;
+            vkAllocateCommandBuffers(device, &alloc_info, command_buffers);
+            frame.command_buffer = command_buffers[0];
+            frame.upload_command_buffer = command_buffers[1];
+
+            if (has_dedicated_transfer_queue()) {
+                VkCommandPoolCreateInfo transfer_pool_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+                transfer_pool_info.queueFamilyIndex = transfer_queue_family;
+                transfer_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                vkCreateCommandPool(device, &transfer_pool_info, nullptr, &frame.transfer_command_pool);
+
+                alloc_info.commandPool = frame.transfer_command_pool;
+                alloc_info.commandBufferCount = 1;
+                vkAllocateCommandBuffers(device, &alloc_info, &frame.transfer_command_buffer);
+
+                vkCreateSemaphore(device, &semaphore_info, nullptr, &frame.upload_finished_semaphore);
+            }
+
+            VkCommandPoolCreateInfo compute_pool_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+            compute_pool_info.queueFamilyIndex = compute_queue_family;
+            compute_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            vkCreateCommandPool(device, &compute_pool_info, nullptr, &frame.compute_command_pool);
+
+            alloc_info.commandPool = frame.compute_command_pool;
+            alloc_info.commandBufferCount = 1;
+            vkAllocateCommandBuffers(device, &alloc_info, &frame.compute_command_buffer);
+            vkCreateSemaphore(device, &semaphore_info, nullptr, &frame.compute_finished_semaphore);
+
+            frame.descriptor_allocator.init(device);
+
+            //secondaries are allocated on first use by the thread owning the slot.
+            frame.secondary_command_pools.resize(recording_pool.get_slot_count());
+            frame.secondary_command_buffers.resize(recording_pool.get_slot_count());
+            frame.secondary_used.resize(recording_pool.get_slot_count());
+            for (auto& secondary_pool : frame.secondary_command_pools) {
+                vkCreateCommandPool(device, &command_pool_info, nullptr, &secondary_pool);
+            }
+
+            frame.staging_buffer = create_buffer(settings.upload_ring_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VulkanBufferMemory::host_visible);
+            frame.staging_offset = 0;
+
+            vkCreateSemaphore(device, &semaphore_info, nullptr, &frame.image_available_semaphore);
+            vkCreateSemaphore(device, &semaphore_info, nullptr, &frame.render_finished_semaphore);
+            vkCreateFence(device, &fence_info, nullptr, &frame.in_flight_fence);
+        }
+    }
+
+    void VulkanContext::load_pipeline_cache() {
+        std::vector<uint8_t> initial_data;
+
+        if (!settings.pipeline_cache_path.empty()) {
+            std::ifstream file(settings.pipeline_cache_path, std::ios::binary);
+            PipelineCacheFileHeader header{};
+
+            if (file && file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+                bool compatible = header.magic == PIPELINE_CACHE_MAGIC &&
+                                  header.version == PIPELINE_CACHE_FILE_VERSION &&
+                                  header.vendor_id == gpu_properties.vendorID &&
+                                  header.device_id == gpu_properties.deviceID &&
+                                  header.driver_version == gpu_properties.driverVersion &&
+                                  std::memcmp(header.cache_uuid, gpu_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+                std::error_code error;
+                auto file_size = std::filesystem::file_size(settings.pipeline_cache_path, error);
+                if (compatible && (error || header.data_size != file_size - sizeof(header))) {
+                    spdlog::warn("[VulkanContext] pipeline cache {} is truncated, starting cold", settings.pipeline_cache_path);
+                    compatible = false;
+                }
+
+                if (compatible) {
+                    initial_data.resize(header.data_size);
+                    if (!file.read(reinterpret_cast<char*>(initial_data.data()), initial_data.size()) ||
+                        fnv1a(initial_data.data(), initial_data.size()) != header.checksum) {
+                        spdlog::warn("[VulkanContext] pipeline cache {} is corrupted, starting cold", settings.pipeline_cache_path);
+                        initial_data.clear();
+                    }
+                } else {
+                    spdlog::info("[VulkanContext] pipeline cache {} was built for another device or driver, starting cold", settings.pipeline_cache_path);
+                }
+            }
+        }
+
+        VkPipelineCacheCreateInfo cache_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+        cache_info.initialDataSize = initial_data.size();
+        cache_info.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+
+        //the driver validates its own header as well, retry empty if it still rejects the blob.
+        if (vkCreatePipelineCache(device, &cache_info, nullptr, &pipeline_cache) != VK_SUCCESS) {
+            cache_info.initialDataSize = 0;
+            cache_info.pInitialData = nullptr;
+            vkCreatePipelineCache(device, &cache_info, nullptr, &pipeline_cache);
+        } else if (!initial_data.empty()) {
+            spdlog::info("[VulkanContext] pipeline cache loaded, {} bytes", initial_data.size());
+        }
+    }
+
+    void VulkanContext::save_pipeline_cache() {
+        if (settings.pipeline_cache_path.empty() || pipeline_cache == VK_NULL_HANDLE) {
+            return;
+        }
 
-        for (auto i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkCreateSemaphore(device, &semaphore_info, nullptr, &image_available_semaphores[i]);
-            vkCreateSemaphore(device, &semaphore_info, nullptr, &render_finished_semaphores[i]);
-            vkCreateFence(device, &fence_info, nullptr, &in_flight_fences[i]);
+        size_t data_size = 0;
+        vkGetPipelineCacheData(device, pipeline_cache, &data_size, nullptr);
+        std::vector<uint8_t> data(data_size);
+        if (data_size == 0 || vkGetPipelineCacheData(device, pipeline_cache, &data_size, data.data()) != VK_SUCCESS) {
+            return;
         }
 
-        //render pass
+        PipelineCacheFileHeader header{};
+        header.magic = PIPELINE_CACHE_MAGIC;
+        header.version = PIPELINE_CACHE_FILE_VERSION;
+        header.vendor_id = gpu_properties.vendorID;
+        header.device_id = gpu_properties.deviceID;
+        header.driver_version = gpu_properties.driverVersion;
+        std::memcpy(header.cache_uuid, gpu_properties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.data_size = data_size;
+        header.checksum = fnv1a(data.data(), data_size);
+
+        //write next to the target and rename over it, a crash mid-write never leaves a truncated cache behind.
+        std::string temporary_path = settings.pipeline_cache_path + ".tmp";
+        {
+            std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), data_size);
+            if (!file.flush()) {
+                spdlog::error("[VulkanContext] failed to write pipeline cache {}", temporary_path);
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporary_path, settings.pipeline_cache_path, error);
+        if (error) {
+            spdlog::error("[VulkanContext] failed to replace pipeline cache {}: {}", settings.pipeline_cache_path, error.message());
+            std::filesystem::remove(temporary_path, error);
+        }
+    }
+
+    void VulkanContext::create_timelines() {
+        VkSemaphoreTypeCreateInfo type_info{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphore_info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        semaphore_info.pNext = &type_info;
+
+        for (auto& timeline : timelines) {
+            vkCreateSemaphore(device, &semaphore_info, nullptr, &timeline.semaphore);
+            timeline.value = 0;
+        }
+    }
+
+    uint64_t VulkanContext::get_completed_timeline_value(VulkanQueueType queue) {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(device, timelines[static_cast<size_t>(queue)].semaphore, &value);
+        return value;
+    }
+
+    bool VulkanContext::is_timeline_complete(VulkanQueueType queue, uint64_t value) {
+        return get_completed_timeline_value(queue) >= value;
+    }
+
+    void VulkanContext::wait_timeline(VulkanQueueType queue, uint64_t value, uint64_t timeout) {
+        if (value == 0) {
+            return;
+        }
+
+        VkSemaphoreWaitInfo wait_info{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &timelines[static_cast<size_t>(queue)].semaphore;
+        wait_info.pValues = &value;
+        vkWaitSemaphores(device, &wait_info, timeout);
+    }
+
+    uint64_t VulkanContext::submit(VulkanQueueType queue, VkSubmitInfo submit_info, const uint64_t* wait_values, VkFence fence) {
+        VkQueue vk_queue = queue == VulkanQueueType::graphics ? graphics_queue :
+                           queue == VulkanQueueType::compute ? compute_queue : transfer_queue;
+
+        if (!settings.timeline_semaphores) {
+            if (vkQueueSubmit(vk_queue, 1, &submit_info, fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit command buffer!");
+            }
+            return 0;
+        }
+
+        //append the queue timeline to the binary signals, binary entries ignore their value.
+        VulkanTimeline& timeline = timelines[static_cast<size_t>(queue)];
+        uint64_t signal_value = timeline.value + 1;
+
+        VkSemaphore signal_semaphores[4]{};
+        uint64_t signal_values[4]{};
+        for (uint32_t i = 0; i < submit_info.signalSemaphoreCount; ++i) {
+            signal_semaphores[i] = submit_info.pSignalSemaphores[i];
+        }
+        signal_semaphores[submit_info.signalSemaphoreCount] = timeline.semaphore;
+        signal_values[submit_info.signalSemaphoreCount] = signal_value;
+
+        VkTimelineSemaphoreSubmitInfo timeline_info{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        timeline_info.waitSemaphoreValueCount = submit_info.waitSemaphoreCount;
+        timeline_info.pWaitSemaphoreValues = wait_values;
+        timeline_info.signalSemaphoreValueCount = submit_info.signalSemaphoreCount + 1;
+        timeline_info.pSignalSemaphoreValues = signal_values;
+
+        submit_info.pNext = &timeline_info;
+        submit_info.signalSemaphoreCount++;
+        submit_info.pSignalSemaphores = signal_semaphores;
+
+        if (vkQueueSubmit(vk_queue, 1, &submit_info, fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit command buffer!");
+        }
+
+        timeline.value = signal_value;
+        return signal_value;
+    }
+
+    void VulkanContext::create_swapchain_renderpass(VkImageLayout final_layout) {
         VkAttachmentDescription attachment_description{};
         VkAttachmentReference attachment_reference{};
 
@@ -172,7 +617,7 @@ namespace vk_sandbox {
         attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         attachment_description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        attachment_description.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        attachment_description.finalLayout = final_layout;
 
         attachment_reference.attachment = 0;
         attachment_reference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -189,86 +634,256 @@ namespace vk_sandbox {
         render_pass_info.pSubpasses = &sub_pass;
 
         vkCreateRenderPass(device, &render_pass_info, nullptr, &swapchain_renderpass);
-        swapchain_framebuffers.resize(images.size());
+    }
 
+    void VulkanContext::create_framebuffers() {
+        //every swapchain image has the same format and usage, imageless mode needs a single framebuffer for all of them.
+        swapchain_framebuffers.resize(settings.imageless_framebuffers ? 1 : images.size());
 
-        for (int i = 0; i < images.size(); ++i) {
-            VkFramebufferCreateInfo fb_info = {VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
-            fb_info.renderPass = swapchain_renderpass;
-            fb_info.width = framebuffer_size.x;
-            fb_info.height = framebuffer_size.y;
-            fb_info.layers = 1;
-            fb_info.attachmentCount = 1;
-            fb_info.pAttachments = &images[i].image_view;
-            vkCreateFramebuffer(device, &fb_info, nullptr, &swapchain_framebuffers[i]);
+        for (int i = 0; i < swapchain_framebuffers.size(); ++i) {
+            swapchain_framebuffers[i] = create_framebuffer(swapchain_renderpass, {images[i]},
+                                                           {static_cast<uint32_t>(extent.x), static_cast<uint32_t>(extent.y)},
+                                                           settings.imageless_framebuffers);
         }
-        spdlog::info("[VulkanContext] swapchain created successfully");
+    }
 
+    VkFramebuffer VulkanContext::create_framebuffer(VkRenderPass render_pass, const std::vector<VulkanImage>& attachments,
+                                                    VkExtent2D size, bool imageless) {
+        VkFramebufferCreateInfo fb_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+        fb_info.renderPass = render_pass;
+        fb_info.width = size.width;
+        fb_info.height = size.height;
+        fb_info.layers = 1;
+        fb_info.attachmentCount = attachments.size();
+
+        std::vector<VkImageView> image_views;
+        std::vector<VkFramebufferAttachmentImageInfo> attachment_infos;
+        VkFramebufferAttachmentsCreateInfo attachments_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO};
+
+        if (imageless) {
+            //only the shape of the attachments is baked in, the views are given when the pass begins.
+            attachment_infos.reserve(attachments.size());
+            for (auto& attachment : attachments) {
+                VkFramebufferAttachmentImageInfo attachment_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO};
+                attachment_info.usage = attachment.usage;
+                attachment_info.width = size.width;
+                attachment_info.height = size.height;
+                attachment_info.layerCount = 1;
+                attachment_info.viewFormatCount = 1;
+                attachment_info.pViewFormats = &attachment.image_format;
+                attachment_infos.push_back(attachment_info);
+            }
+            attachments_info.attachmentImageInfoCount = attachment_infos.size();
+            attachments_info.pAttachmentImageInfos = attachment_infos.data();
+            fb_info.flags = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT;
+            fb_info.pNext = &attachments_info;
+        } else {
+            for (auto& attachment : attachments) {
+                image_views.push_back(attachment.image_view);
+            }
+            fb_info.pAttachments = image_views.data();
+        }
+
+        VkFramebuffer framebuffer{};
+        if (vkCreateFramebuffer(device, &fb_info, nullptr, &framebuffer) != VK_SUCCESS) {
+            spdlog::error("[VulkanContext] failed to create framebuffer {}x{}", size.width, size.height);
+            return VK_NULL_HANDLE;
+        }
+        return framebuffer;
     }
 
     bool VulkanContext::begin_frame(glm::ivec2 size) {
+        VulkanFrame& frame = frames[current_frame];
+
+        //the slot is reused every frames_in_flight frames, wait until the GPU is done with it before recording.
+        uint64_t wait_begin = CpuProfiler::now();
+        {
+            CpuZone zone("wait_frame_fence");
+            if (settings.timeline_semaphores) {
+                wait_timeline(VulkanQueueType::graphics, frame.graphics_timeline_value);
+            } else {
+                vkWaitForFences(device, 1, &frame.in_flight_fence, VK_TRUE, UINT64_MAX);
+            }
+        }
+        fence_wait_milliseconds = (CpuProfiler::now() - wait_begin) / 1e6;
+        flush_deletion_queue(false);
+        if (settings.bindless) {
+            bindless_table.recycle(frame_number, frames.size());
+        }
+        descriptor_cache.recycle(frame_number, frames.size());
+
+        if (settings.headless) {
+            //offscreen images are simply cycled, there is nothing to acquire.
+            image_index = current_frame;
+        } else {
+            //minimized, nothing to render into.
+            if (size.x <= 0 || size.y <= 0) {
+                return false;
+            }
 
-        auto result = vkAcquireNextImageKHR(device,
-                                            swapchain_khr,
-                                            UINT64_MAX,
-                                            image_available_semaphores[current_frame],
-                                            VK_NULL_HANDLE,
-                                            &image_index);
+            if (swapchain_dirty || size != requested_extent) {
+                if (!build_swapchain(size)) {
+                    return false;
+                }
+            }
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-            //TODO - recreate_swapchain();
-            return false;
-        } else if (result != VK_SUCCESS) {
-            spdlog::error("[VulkanRendererContext] failed to acquire swap chain image!");
-            return false;
+            CpuZone zone("acquire_image");
+            auto result = vkAcquireNextImageKHR(device,
+                                                swapchain_khr,
+                                                UINT64_MAX,
+                                                frame.image_available_semaphore,
+                                                VK_NULL_HANDLE,
+                                                &image_index);
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                swapchain_dirty = true;
+                return false;
+            } else if (result == VK_SUBOPTIMAL_KHR) {
+                //the image is acquired and the semaphore will signal, render this frame and recreate on the next.
+                swapchain_dirty = true;
+            } else if (result != VK_SUCCESS) {
+                spdlog::error("[VulkanRendererContext] failed to acquire swap chain image!");
+                return false;
+            }
         }
 
+        //the acquired image may still be in use by an older frame slot.
+        wait_begin = CpuProfiler::now();
+        {
+            CpuZone zone("wait_image_fence");
+            if (settings.timeline_semaphores) {
+                wait_timeline(VulkanQueueType::graphics, images_in_flight_values[image_index]);
+            } else {
+                if (images_in_flight[image_index] != VK_NULL_HANDLE && images_in_flight[image_index] != frame.in_flight_fence) {
+                    vkWaitForFences(device, 1, &images_in_flight[image_index], VK_TRUE, UINT64_MAX);
+                }
+                images_in_flight[image_index] = frame.in_flight_fence;
+                vkResetFences(device, 1, &frame.in_flight_fence);
+            }
+        }
+        fence_wait_milliseconds += (CpuProfiler::now() - wait_begin) / 1e6;
+
+        vkResetCommandPool(device, frame.command_pool, 0);
+        if (frame.transfer_command_pool != VK_NULL_HANDLE) {
+            vkResetCommandPool(device, frame.transfer_command_pool, 0);
+        }
+        vkResetCommandPool(device, frame.compute_command_pool, 0);
+        for (size_t slot = 0; slot < frame.secondary_command_pools.size(); ++slot) {
+            vkResetCommandPool(device, frame.secondary_command_pools[slot], 0);
+            frame.secondary_used[slot] = 0;
+        }
+        frame.compute_recording = false;
+        frame.compute_submitted = false;
+        frame.descriptor_allocator.reset();
+        frame.staging_offset = 0;
+
         VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-        vkBeginCommandBuffer(cmds[image_index], &begin_info);
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(frame.command_buffer, &begin_info);
 
-        begin_render_pass(swapchain_renderpass, swapchain_framebuffers[image_index], size);
+        gpu_profiler.begin_frame(frame.command_buffer, current_frame);
+        frame_region = gpu_profiler.begin_region(frame.command_buffer, "frame");
+
+        //the swapchain pass begins on the first get_command_buffer so offscreen work can be recorded ahead of it.
+        swapchain_pass_active = false;
+        backbuffer_written = false;
+        recording_frame = true;
         return true;
     }
 
     void VulkanContext::end_frame() {
+        VulkanFrame& frame = frames[current_frame];
+
+        //nothing drew this frame, the swapchain pass still runs to clear the image and move it to its final layout.
+        if (!swapchain_pass_active && !backbuffer_written) {
+            get_command_buffer();
+        }
+        if (swapchain_pass_active) {
+            end_render_pass();
+            swapchain_pass_active = false;
+        }
+
+        gpu_profiler.end_region(frame.command_buffer, frame_region);
+        vkEndCommandBuffer(frame.command_buffer);
+        recording_frame = false;
 
-        //temporary
-        vkCmdEndRenderPass(cmds[image_index]);
+        if (frame.compute_recording) {
+            submit_compute();
+        }
 
-        vkEndCommandBuffer(cmds[image_index]);
-        vkWaitForFences(device, 1, &in_flight_fences[current_frame], VK_TRUE, UINT64_MAX);
+        bool has_uploads = record_uploads(frame);
+        VkCommandBuffer command_buffers[] = {frame.upload_command_buffer, frame.command_buffer};
+
+        //binary semaphores or, in timeline mode, the other queues' timelines at the values they signal.
+        VkSemaphore wait_semaphores[3]{};
+        uint64_t wait_values[3]{};
+        VkPipelineStageFlags waitStages[3]{};
+        uint32_t wait_count = 0;
+
+        if (frame.compute_submitted) {
+            if (settings.timeline_semaphores) {
+                wait_semaphores[wait_count] = timelines[static_cast<size_t>(VulkanQueueType::compute)].semaphore;
+                wait_values[wait_count] = frame.compute_timeline_value;
+            } else {
+                wait_semaphores[wait_count] = frame.compute_finished_semaphore;
+            }
+            waitStages[wait_count++] = frame.compute_wait_stage;
+        }
 
-        if (images_in_flight[image_index] != VK_NULL_HANDLE) {
-            vkWaitForFences(device, 1, &images_in_flight[image_index], VK_TRUE, UINT64_MAX);
+        if (!settings.headless) {
+            wait_semaphores[wait_count] = frame.image_available_semaphore;
+            waitStages[wait_count++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         }
 
-        images_in_flight[image_index] = in_flight_fences[current_frame];
+        if (frame.transfer_uploads) {
+            //first uploads run on the transfer queue while the previous frames are still rendering, none of them reads the destinations.
+            VkSubmitInfo transfer_submit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            transfer_submit.commandBufferCount = 1;
+            transfer_submit.pCommandBuffers = &frame.transfer_command_buffer;
+            transfer_submit.signalSemaphoreCount = settings.timeline_semaphores ? 0 : 1;
+            transfer_submit.pSignalSemaphores = &frame.upload_finished_semaphore;
+
+            uint64_t transfer_value = submit(VulkanQueueType::transfer, transfer_submit, nullptr, VK_NULL_HANDLE);
+
+            if (settings.timeline_semaphores) {
+                wait_semaphores[wait_count] = timelines[static_cast<size_t>(VulkanQueueType::transfer)].semaphore;
+                wait_values[wait_count] = transfer_value;
+            } else {
+                wait_semaphores[wait_count] = frame.upload_finished_semaphore;
+            }
+            waitStages[wait_count++] = UPLOAD_READ_STAGES;
+        }
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore wait_semaphores[] = {image_available_semaphores[current_frame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = wait_count;
         submitInfo.pWaitSemaphores = wait_semaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &cmds[image_index];
+        submitInfo.commandBufferCount = has_uploads ? 2 : 1;
+        submitInfo.pCommandBuffers = has_uploads ? command_buffers : &frame.command_buffer;
 
-        VkSemaphore signalSemaphores[] = {render_finished_semaphores[current_frame]};
-        submitInfo.signalSemaphoreCount = 1;
+        VkSemaphore signalSemaphores[] = {frame.render_finished_semaphore};
+        submitInfo.signalSemaphoreCount = settings.headless ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
-        vkResetFences(device, 1, &in_flight_fences[current_frame]);
+        //timeline mode signals the graphics timeline instead of a fence that would need resetting.
+        VkFence fence = settings.timeline_semaphores ? VK_NULL_HANDLE : frame.in_flight_fence;
+        {
+            CpuZone zone("queue_submit");
+            frame.graphics_timeline_value = submit(VulkanQueueType::graphics, submitInfo, wait_values, fence);
+        }
+        images_in_flight_values[image_index] = frame.graphics_timeline_value;
 
-        auto result = vkQueueSubmit(graphics_queue, 1, &submitInfo, in_flight_fences[current_frame]);
+        current_frame = (current_frame + 1) % frames.size();
+        frame_number++;
 
-        if (result != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+        if (settings.headless) {
+            return;
         }
 
-        VkSemaphore signal_semaphores[] = {render_finished_semaphores[current_frame]};
+        VkSemaphore signal_semaphores[] = {frame.render_finished_semaphore};
 
         VkPresentInfoKHR present_info{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
         present_info.waitSemaphoreCount = 1;
@@ -280,23 +895,1038 @@ namespace vk_sandbox {
 
         present_info.pImageIndices = &image_index;
 
-        result = vkQueuePresentKHR(present_queue, &present_info);
+        CpuZone zone("present");
+        uint64_t present_begin = CpuProfiler::now();
+        auto result = vkQueuePresentKHR(present_queue, &present_info);
+        present_milliseconds = (CpuProfiler::now() - present_begin) / 1e6;
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-            //TODO recreate_swapchain();
+            swapchain_dirty = true;
         } else if (result != VK_SUCCESS) {
             spdlog::error("[VulkanRendererContext] failed to present swap chain image!");
         }
     }
 
 
-    VulkanRenderTarget VulkanContext::create_render_target() {
+    VkCommandBuffer VulkanContext::get_command_buffer() {
+        if (recording_frame && !swapchain_pass_active && !backbuffer_written) {
+            begin_swapchain_pass(VK_SUBPASS_CONTENTS_INLINE);
+        }
+        return frames[current_frame].command_buffer;
+    }
+
+    void VulkanContext::begin_swapchain_pass(VkSubpassContents contents) {
+        VkClearValue clear_value{};
+        clear_value.color = {0.2f, 0.3f, 0.3f, 1.0f};
+        if (settings.imageless_framebuffers) {
+            begin_render_pass(swapchain_renderpass, swapchain_framebuffers[0], extent, &clear_value, 1,
+                              &images[image_index].image_view, 1, contents, "swapchain");
+        } else {
+            begin_render_pass(swapchain_renderpass, swapchain_framebuffers[image_index], extent, &clear_value, 1,
+                              nullptr, 0, contents, "swapchain");
+        }
+        swapchain_pass_active = true;
+    }
+
+    void VulkanContext::record_parallel(uint32_t task_count, const std::function<void(uint32_t, VkCommandBuffer)>& record) {
+        if (!recording_frame) {
+            spdlog::error("[VulkanContext] parallel recording has to happen inside a frame");
+            return;
+        }
+        if (active_pass.render_pass == VK_NULL_HANDLE) {
+            if (backbuffer_written) {
+                spdlog::error("[VulkanContext] no render pass to record secondaries into, the backbuffer was already written");
+                return;
+            }
+            begin_swapchain_pass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        } else if (active_pass.contents != VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+            spdlog::error("[VulkanContext] the active render pass was begun with inline contents, it can't execute secondaries");
+            return;
+        }
+        if (task_count == 0) {
+            return;
+        }
+
+        VulkanFrame& frame = frames[current_frame];
+        parallel_command_buffers.assign(task_count, VK_NULL_HANDLE);
+
+        VkCommandBufferInheritanceInfo inheritance_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+        inheritance_info.renderPass = active_pass.render_pass;
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = active_pass.framebuffer;
+
+        VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        begin_info.pInheritanceInfo = &inheritance_info;
+
+        //every slot records into its own pool, the only shared write is the task's entry in the list.
+        recording_pool.parallel_for(task_count, [&](uint32_t task, uint32_t slot) {
+            CpuZone zone("record_secondary");
+            VkCommandBuffer cmd = acquire_secondary_command_buffer(frame, slot);
+            vkBeginCommandBuffer(cmd, &begin_info);
+            set_viewport(cmd, active_pass.size);
+            record(task, cmd);
+            vkEndCommandBuffer(cmd);
+            parallel_command_buffers[task] = cmd;
+        });
+
+        vkCmdExecuteCommands(frame.command_buffer, task_count, parallel_command_buffers.data());
+    }
+
+    VkCommandBuffer VulkanContext::acquire_secondary_command_buffer(VulkanFrame& frame, uint32_t slot) {
+        std::vector<VkCommandBuffer>& command_buffers = frame.secondary_command_buffers[slot];
+        uint32_t& used = frame.secondary_used[slot];
+        if (used == command_buffers.size()) {
+            VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            alloc_info.commandPool = frame.secondary_command_pools[slot];
+            alloc_info.commandBufferCount = 1;
+            VkCommandBuffer command_buffer{};
+            vkAllocateCommandBuffers(device, &alloc_info, &command_buffer);
+            command_buffers.push_back(command_buffer);
+        }
+        return command_buffers[used++];
+    }
+
+    VulkanImage VulkanContext::create_image(VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkSampleCountFlagBits samples,
+                                            VmaMemoryUsage memory_usage) {
+        VulkanImage image{};
+        image.image_format = format;
+        image.extent = extent;
+        image.usage = usage;
+
+        VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = format;
+        image_info.extent = extent;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = samples;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = usage;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VmaAllocationCreateInfo alloc_info{};
+        alloc_info.usage = memory_usage;
+
+        if (vmaCreateImage(allocator, &image_info, &alloc_info, &image.image, &image.allocation, nullptr) != VK_SUCCESS) {
+            spdlog::error("[VulkanContext] failed to create image {}x{}", extent.width, extent.height);
+            return {};
+        }
 
+        VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        view_info.image = image.image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = format;
+        view_info.subresourceRange.aspectMask = get_format_aspect(format);
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.layerCount = 1;
+
+        vkCreateImageView(device, &view_info, nullptr, &image.image_view);
+        return image;
+    }
+
+    VulkanBuffer VulkanContext::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VulkanBufferMemory memory) {
+        VulkanBuffer vulkan_buffer{};
+        vulkan_buffer.size = size;
+        vulkan_buffer.memory = memory;
+
+        VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        buffer_info.size = size;
+        buffer_info.usage = usage;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        //storage buffers are produced and consumed across graphics and async compute, avoid ownership transfers.
+        uint32_t queue_families[] = {graphics_queue_family, compute_queue_family, transfer_queue_family};
+        if ((usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) && has_async_compute_queue()) {
+            buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            buffer_info.queueFamilyIndexCount = has_dedicated_transfer_queue() && transfer_queue_family != compute_queue_family ? 3 : 2;
+            buffer_info.pQueueFamilyIndices = queue_families;
+            vulkan_buffer.sharing_mode = VK_SHARING_MODE_CONCURRENT;
+        }
+
+        VmaAllocationCreateInfo alloc_info{};
+
+        switch (memory) {
+            case VulkanBufferMemory::device_local:
+                //device local data can only be filled by copies.
+                buffer_info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+                alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+                break;
+            case VulkanBufferMemory::host_visible:
+                alloc_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+                alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+                break;
+            case VulkanBufferMemory::readback:
+                buffer_info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+                alloc_info.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+                alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+                break;
+        }
+
+        VmaAllocationInfo allocation_info{};
+        auto result = vmaCreateBuffer(allocator, &buffer_info, &alloc_info, &vulkan_buffer.buffer, &vulkan_buffer.allocation, &allocation_info);
+
+        if (result != VK_SUCCESS) {
+            spdlog::error("[VulkanContext] failed to create buffer of {} bytes", size);
+            return VulkanBuffer{};
+        }
+
+        vulkan_buffer.mapped = allocation_info.pMappedData;
+        return vulkan_buffer;
+    }
+
+    void* VulkanContext::map_buffer(const VulkanBuffer& buffer) {
+        if (buffer.mapped == nullptr) {
+            spdlog::error("[VulkanContext] buffer is not host visible, it must be filled through a transfer");
+        }
+        return buffer.mapped;
+    }
+
+    void VulkanContext::flush_buffer(const VulkanBuffer& buffer, VkDeviceSize offset, VkDeviceSize size) {
+        //no-op on host coherent memory, VMA checks the memory type.
+        vmaFlushAllocation(allocator, buffer.allocation, offset, size);
+    }
 
-        return VulkanRenderTarget();
+    void VulkanContext::invalidate_buffer(const VulkanBuffer& buffer, VkDeviceSize offset, VkDeviceSize size) {
+        vmaInvalidateAllocation(allocator, buffer.allocation, offset, size);
     }
 
-    void VulkanContext::begin_render_pass(VkRenderPass render_pass, VkFramebuffer framebuffer, glm::ivec2 size) {
+    void VulkanContext::destroy_buffer(VulkanBuffer& buffer) {
+        if (buffer.buffer != VK_NULL_HANDLE) {
+            destroy_deferred(buffer.buffer, buffer.allocation);
+        }
+        buffer = VulkanBuffer{};
+    }
+
+    void VulkanContext::upload_buffer(const VulkanBuffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset) {
+        if (!recording_frame) {
+            spdlog::error("[VulkanContext] uploads must be issued between begin_frame and end_frame");
+            return;
+        }
+
+        VkDeviceSize src_offset = stage_upload(data, size);
+        if (src_offset == INVALID_STAGING_OFFSET) {
+            return;
+        }
+
+        VulkanFrame& frame = frames[current_frame];
+        PendingBufferCopy copy{};
+        copy.src = frame.staging_buffer.buffer;
+        copy.dst = dst.buffer;
+        copy.exclusive = dst.sharing_mode == VK_SHARING_MODE_EXCLUSIVE;
+        copy.transfer_queue = has_dedicated_transfer_queue() && uploaded_resources.count(reinterpret_cast<uint64_t>(dst.buffer)) == 0;
+        copy.region.srcOffset = src_offset;
+        copy.region.dstOffset = dst_offset;
+        copy.region.size = size;
+        frame.buffer_copies.push_back(copy);
+    }
+
+    void VulkanContext::upload_image(const VulkanImage& dst, const void* data, VkDeviceSize size, VkImageLayout final_layout) {
+        if (!recording_frame) {
+            spdlog::error("[VulkanContext] uploads must be issued between begin_frame and end_frame");
+            return;
+        }
+
+        VkDeviceSize src_offset = stage_upload(data, size);
+        if (src_offset == INVALID_STAGING_OFFSET) {
+            return;
+        }
+
+        VulkanFrame& frame = frames[current_frame];
+        PendingImageCopy copy{};
+        copy.src = frame.staging_buffer.buffer;
+        copy.dst = dst.image;
+        copy.final_layout = final_layout;
+        copy.transfer_queue = has_dedicated_transfer_queue() && uploaded_resources.count(reinterpret_cast<uint64_t>(dst.image)) == 0;
+        copy.region.bufferOffset = src_offset;
+        copy.region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copy.region.imageSubresource.mipLevel = 0;
+        copy.region.imageSubresource.baseArrayLayer = 0;
+        copy.region.imageSubresource.layerCount = 1;
+        copy.region.imageExtent = dst.extent;
+        frame.image_copies.push_back(copy);
+    }
+
+    VkCommandBuffer VulkanContext::begin_compute() {
+        VulkanFrame& frame = frames[current_frame];
+
+        if (!recording_frame || frame.compute_submitted) {
+            spdlog::error("[VulkanContext] compute must be recorded between begin_frame and end_frame, once per frame");
+            return VK_NULL_HANDLE;
+        }
+
+        if (!frame.compute_recording) {
+            VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(frame.compute_command_buffer, &begin_info);
+            frame.compute_recording = true;
+        }
+        return frame.compute_command_buffer;
+    }
+
+    void VulkanContext::dispatch(VkPipeline pipeline, VkPipelineLayout layout, const std::vector<VkDescriptorSet>& descriptor_sets, glm::uvec3 group_count) {
+        VkCommandBuffer cmd = begin_compute();
+        if (cmd == VK_NULL_HANDLE) {
+            return;
+        }
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        if (!descriptor_sets.empty()) {
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, descriptor_sets.size(), descriptor_sets.data(), 0, nullptr);
+        }
+        vkCmdDispatch(cmd, group_count.x, group_count.y, group_count.z);
+    }
+
+    void VulkanContext::submit_compute(VkPipelineStageFlags graphics_wait_stage) {
+        VulkanFrame& frame = frames[current_frame];
+        if (!frame.compute_recording) {
+            return;
+        }
+
+        //compute writes become visible to the graphics reads through the semaphore signal/wait pair.
+        vkEndCommandBuffer(frame.compute_command_buffer);
+
+        VkSubmitInfo compute_submit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        compute_submit.commandBufferCount = 1;
+        compute_submit.pCommandBuffers = &frame.compute_command_buffer;
+        compute_submit.signalSemaphoreCount = settings.timeline_semaphores ? 0 : 1;
+        compute_submit.pSignalSemaphores = &frame.compute_finished_semaphore;
+
+        frame.compute_timeline_value = submit(VulkanQueueType::compute, compute_submit, nullptr, VK_NULL_HANDLE);
+
+        frame.compute_recording = false;
+        frame.compute_submitted = true;
+        frame.compute_wait_stage = graphics_wait_stage;
+    }
+
+    VkDescriptorSet VulkanContext::allocate_descriptor_set(VkDescriptorSetLayout layout) {
+        return descriptor_allocator.allocate(layout);
+    }
+
+    VkDescriptorSet VulkanContext::allocate_frame_descriptor_set(VkDescriptorSetLayout layout) {
+        return frames[current_frame].descriptor_allocator.allocate(layout);
+    }
+
+    VkDescriptorSetLayout VulkanContext::get_descriptor_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+        return descriptor_cache.get_layout(bindings);
+    }
+
+    VkDescriptorSet VulkanContext::get_descriptor_set(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings) {
+        return descriptor_cache.get_set(layout, bindings);
+    }
+
+    void VulkanContext::invalidate_descriptor_sets() {
+        descriptor_cache.evict_sets(frame_number);
+    }
+
+    uint32_t VulkanContext::register_bindless_texture(const VulkanImage& image, VkImageLayout image_layout) {
+        if (!settings.bindless) {
+            spdlog::error("[VulkanContext] bindless mode is not enabled");
+            return INVALID_BINDLESS_HANDLE;
+        }
+        return bindless_table.add_texture(image.image_view, image.sampler, image_layout);
+    }
+
+    uint32_t VulkanContext::register_bindless_buffer(const VulkanBuffer& buffer) {
+        if (!settings.bindless) {
+            spdlog::error("[VulkanContext] bindless mode is not enabled");
+            return INVALID_BINDLESS_HANDLE;
+        }
+        return bindless_table.add_buffer(buffer.buffer, 0, buffer.size);
+    }
+
+    void VulkanContext::release_bindless_texture(uint32_t handle) {
+        bindless_table.release_texture(handle, frame_number);
+    }
+
+    void VulkanContext::release_bindless_buffer(uint32_t handle) {
+        bindless_table.release_buffer(handle, frame_number);
+    }
+
+    VkPipeline VulkanContext::get_graphics_pipeline(const GraphicsPipelineDesc& desc) {
+        return pipeline_state_cache.get_or_create(desc);
+    }
+
+    VkPipeline VulkanContext::request_graphics_pipeline(const GraphicsPipelineDesc& desc, VkPipeline fallback) {
+        return pipeline_state_cache.get_or_request(desc, fallback);
+    }
+
+    VkShaderModule VulkanContext::create_shader_module(const uint32_t* code, size_t size) {
+        std::vector<uint32_t> words(code, code + size / sizeof(uint32_t));
+        size_t code_hash = 0;
+        for (uint32_t word : words) {
+            hash_combine(code_hash, word);
+        }
+
+        auto range = shader_modules.equal_range(code_hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.code == words) {
+                return it->second.module;
+            }
+        }
+
+        VkShaderModuleCreateInfo module_info{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        module_info.codeSize = size;
+        module_info.pCode = code;
+
+        VkShaderModule shader_module{};
+        if (vkCreateShaderModule(device, &module_info, nullptr, &shader_module) != VK_SUCCESS) {
+            spdlog::error("[VulkanContext] failed to create shader module");
+            return VK_NULL_HANDLE;
+        }
+        shader_modules.emplace(code_hash, CachedShaderModule{std::move(words), shader_module});
+        return shader_module;
+    }
+
+    void VulkanContext::destroy_shader_module(VkShaderModule) {
+        //cached pipelines are keyed on the module handle and background compiles may still read the module,
+        //destroying it now would let a recycled handle hit a stale pipeline. Modules go with the pipeline cache instead.
+    }
+
+    void VulkanContext::bind_bindless_set(VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout, uint32_t set_index) {
+        VkDescriptorSet descriptor_set = bindless_table.get_set();
+        vkCmdBindDescriptorSets(cmd, bind_point, pipeline_layout, set_index, 1, &descriptor_set, 0, nullptr);
+    }
+
+    VkDeviceSize VulkanContext::stage_upload(const void* data, VkDeviceSize size) {
+        VulkanFrame& frame = frames[current_frame];
+        VkDeviceSize offset = (frame.staging_offset + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1);
+
+        if (offset + size > frame.staging_buffer.size) {
+            //grow instead of failing, copies recorded earlier this frame keep the old ring alive until it retires.
+            VkDeviceSize new_size = std::max(frame.staging_buffer.size * 2, size);
+            spdlog::warn("[VulkanContext] upload ring exhausted, growing to {} bytes", new_size);
+
+            VulkanBuffer staging_buffer = create_buffer(new_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VulkanBufferMemory::host_visible);
+            if (staging_buffer.mapped == nullptr) {
+                //keep the old ring, the copies already staged in it still go out.
+                spdlog::error("[VulkanContext] failed to grow the upload ring, dropping an upload of {} bytes", size);
+                destroy_buffer(staging_buffer);
+                return INVALID_STAGING_OFFSET;
+            }
+
+            flush_buffer(frame.staging_buffer, 0, frame.staging_offset);
+            destroy_buffer(frame.staging_buffer);
+            frame.staging_buffer = staging_buffer;
+            offset = 0;
+        }
+
+        std::memcpy(static_cast<char*>(frame.staging_buffer.mapped) + offset, data, size);
+        frame.staging_offset = offset + size;
+        return offset;
+    }
+
+    bool VulkanContext::record_uploads(VulkanFrame& frame) {
+        frame.transfer_uploads = false;
+        if (frame.buffer_copies.empty() && frame.image_copies.empty()) {
+            return false;
+        }
+
+        flush_buffer(frame.staging_buffer, 0, frame.staging_offset);
+
+        //first uploads run on the dedicated transfer queue, everything else is recorded into the graphics upload buffer.
+        bool transfer_uploads = std::any_of(frame.buffer_copies.begin(), frame.buffer_copies.end(),
+                                            [](const PendingBufferCopy& copy) { return copy.transfer_queue; }) ||
+                                std::any_of(frame.image_copies.begin(), frame.image_copies.end(),
+                                            [](const PendingImageCopy& copy) { return copy.transfer_queue; });
+        bool graphics_uploads = std::any_of(frame.buffer_copies.begin(), frame.buffer_copies.end(),
+                                            [](const PendingBufferCopy& copy) { return !copy.transfer_queue; }) ||
+                                std::any_of(frame.image_copies.begin(), frame.image_copies.end(),
+                                            [](const PendingImageCopy& copy) { return !copy.transfer_queue; });
+
+        VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        std::vector<VkImageMemoryBarrier> image_barriers;
+        VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        image_barrier.subresourceRange.levelCount = 1;
+        image_barrier.subresourceRange.layerCount = 1;
+
+        auto add_image_barrier = [&](VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+                                     VkAccessFlags src_access, VkAccessFlags dst_access) {
+            bool transitioned = std::any_of(image_barriers.begin(), image_barriers.end(), [&](const VkImageMemoryBarrier& barrier) {
+                return barrier.image == image;
+            });
+            if (transitioned) {
+                return;
+            }
+            image_barrier.image = image;
+            image_barrier.oldLayout = old_layout;
+            image_barrier.newLayout = new_layout;
+            image_barrier.srcAccessMask = src_access;
+            image_barrier.dstAccessMask = dst_access;
+            image_barriers.push_back(image_barrier);
+        };
+
+        auto record_copies = [&](VkCommandBuffer cmd, bool transfer_queue) {
+            //consecutive copies between the same pair of buffers collapse into a single command.
+            for (size_t first = 0; first < frame.buffer_copies.size();) {
+                const PendingBufferCopy& run = frame.buffer_copies[first];
+                copy_regions.clear();
+
+                size_t last = first;
+                while (last < frame.buffer_copies.size() && frame.buffer_copies[last].src == run.src &&
+                       frame.buffer_copies[last].dst == run.dst && frame.buffer_copies[last].transfer_queue == run.transfer_queue) {
+                    copy_regions.push_back(frame.buffer_copies[last].region);
+                    last++;
+                }
+
+                if (run.transfer_queue == transfer_queue) {
+                    vkCmdCopyBuffer(cmd, run.src, run.dst, copy_regions.size(), copy_regions.data());
+                }
+                first = last;
+            }
+
+            for (auto& copy : frame.image_copies) {
+                if (copy.transfer_queue == transfer_queue) {
+                    vkCmdCopyBufferToImage(cmd, copy.src, copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+                }
+            }
+        };
+
+        std::vector<VkBufferMemoryBarrier> buffer_barriers;
+        if (transfer_uploads) {
+            VkCommandBuffer cmd = frame.transfer_command_buffer;
+            vkBeginCommandBuffer(cmd, &begin_info);
+
+            //no frame in flight references a resource before its first upload, the copies have nothing to wait for.
+            for (auto& copy : frame.image_copies) {
+                if (copy.transfer_queue) {
+                    add_image_barrier(copy.dst, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+                }
+            }
+            if (!image_barriers.empty()) {
+                vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                     0, nullptr, 0, nullptr, image_barriers.size(), image_barriers.data());
+            }
+
+            record_copies(cmd, true);
+
+            //exclusive resources change queue family: release on the transfer queue, acquire on the graphics queue
+            //with identical barriers, the layout transition happens once as part of the pair.
+            uploaded_buffers.clear();
+            for (auto& copy : frame.buffer_copies) {
+                if (copy.transfer_queue && copy.exclusive) {
+                    uploaded_buffers.push_back(copy.dst);
+                }
+            }
+            std::sort(uploaded_buffers.begin(), uploaded_buffers.end());
+            uploaded_buffers.erase(std::unique(uploaded_buffers.begin(), uploaded_buffers.end()), uploaded_buffers.end());
+
+            buffer_barriers.assign(uploaded_buffers.size(), {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER});
+            for (size_t i = 0; i < uploaded_buffers.size(); ++i) {
+                buffer_barriers[i].srcQueueFamilyIndex = transfer_queue_family;
+                buffer_barriers[i].dstQueueFamilyIndex = graphics_queue_family;
+                buffer_barriers[i].buffer = uploaded_buffers[i];
+                buffer_barriers[i].offset = 0;
+                buffer_barriers[i].size = VK_WHOLE_SIZE;
+                buffer_barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            }
+
+            image_barriers.clear();
+            image_barrier.srcQueueFamilyIndex = transfer_queue_family;
+            image_barrier.dstQueueFamilyIndex = graphics_queue_family;
+            for (auto& copy : frame.image_copies) {
+                if (copy.transfer_queue) {
+                    add_image_barrier(copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copy.final_layout, VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+                }
+            }
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                 0, nullptr, buffer_barriers.size(), buffer_barriers.data(), image_barriers.size(), image_barriers.data());
+            vkEndCommandBuffer(cmd);
+        }
+
+        VkCommandBuffer cmd = frame.upload_command_buffer;
+        vkBeginCommandBuffer(cmd, &begin_info);
+
+        if (transfer_uploads) {
+            for (auto& barrier : buffer_barriers) {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+            }
+            for (auto& barrier : image_barriers) {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            }
+            vkCmdPipelineBarrier(cmd, UPLOAD_READ_STAGES, UPLOAD_READ_STAGES, 0,
+                                 0, nullptr, buffer_barriers.size(), buffer_barriers.data(), image_barriers.size(), image_barriers.data());
+        }
+
+        if (graphics_uploads) {
+            image_barriers.clear();
+            image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            for (auto& copy : frame.image_copies) {
+                if (!copy.transfer_queue) {
+                    add_image_barrier(copy.dst, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+                }
+            }
+
+            //frames submitted earlier on this queue may still read the destinations, or have written storage buffers in shaders.
+            VkMemoryBarrier memory_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+            memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            vkCmdPipelineBarrier(cmd, UPLOAD_READ_STAGES, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 1, &memory_barrier, 0, nullptr, image_barriers.size(), image_barriers.data());
+
+            record_copies(cmd, false);
+
+            image_barriers.clear();
+            for (auto& copy : frame.image_copies) {
+                if (!copy.transfer_queue) {
+                    add_image_barrier(copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copy.final_layout,
+                                      VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+                }
+            }
+
+            //make every copy visible to the reads of the frame submitted right after.
+            memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memory_barrier.dstAccessMask = UPLOAD_READ_ACCESS;
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, UPLOAD_READ_STAGES, 0,
+                                 1, &memory_barrier, 0, nullptr, image_barriers.size(), image_barriers.data());
+        }
+        vkEndCommandBuffer(cmd);
+
+        //from now on the resources may be read by frames in flight and belong to the graphics queue family.
+        for (auto& copy : frame.buffer_copies) {
+            uploaded_resources.insert(reinterpret_cast<uint64_t>(copy.dst));
+        }
+        for (auto& copy : frame.image_copies) {
+            uploaded_resources.insert(reinterpret_cast<uint64_t>(copy.dst));
+        }
+
+        frame.transfer_uploads = transfer_uploads;
+        frame.buffer_copies.clear();
+        frame.image_copies.clear();
+        return true;
+    }
+
+    void VulkanContext::destroy_deferred(VkBuffer buffer, VmaAllocation allocation) {
+        uploaded_resources.erase(reinterpret_cast<uint64_t>(buffer));
+        descriptor_cache.evict(reinterpret_cast<uint64_t>(buffer), frame_number);
+        defer_deletion(VK_OBJECT_TYPE_BUFFER, reinterpret_cast<uint64_t>(buffer), allocation);
+    }
+
+    void VulkanContext::destroy_deferred(VkImage image, VmaAllocation allocation) {
+        uploaded_resources.erase(reinterpret_cast<uint64_t>(image));
+        defer_deletion(VK_OBJECT_TYPE_IMAGE, reinterpret_cast<uint64_t>(image), allocation);
+    }
+
+    void VulkanContext::destroy_deferred(VmaAllocation allocation) {
+        defer_deletion(VK_OBJECT_TYPE_UNKNOWN, 0, allocation);
+    }
+
+    void VulkanContext::destroy_deferred(VkImageView image_view) {
+        descriptor_cache.evict(reinterpret_cast<uint64_t>(image_view), frame_number);
+        defer_deletion(VK_OBJECT_TYPE_IMAGE_VIEW, reinterpret_cast<uint64_t>(image_view));
+    }
+
+    void VulkanContext::destroy_deferred(VkSampler sampler) {
+        descriptor_cache.evict(reinterpret_cast<uint64_t>(sampler), frame_number);
+        defer_deletion(VK_OBJECT_TYPE_SAMPLER, reinterpret_cast<uint64_t>(sampler));
+    }
+
+    void VulkanContext::destroy_deferred(VkFramebuffer framebuffer) {
+        defer_deletion(VK_OBJECT_TYPE_FRAMEBUFFER, reinterpret_cast<uint64_t>(framebuffer));
+    }
+
+    void VulkanContext::destroy_deferred(VkRenderPass render_pass) {
+        evict_pipelines(reinterpret_cast<uint64_t>(render_pass));
+        defer_deletion(VK_OBJECT_TYPE_RENDER_PASS, reinterpret_cast<uint64_t>(render_pass));
+    }
+
+    void VulkanContext::destroy_deferred(VkPipeline pipeline) {
+        if (pipeline_state_cache.owns(pipeline)) {
+            spdlog::error("[VulkanContext] cached pipelines live until their layout or render pass is destroyed, ignoring destroy");
+            return;
+        }
+        defer_deletion(VK_OBJECT_TYPE_PIPELINE, reinterpret_cast<uint64_t>(pipeline));
+    }
+
+    void VulkanContext::destroy_deferred(VkPipelineLayout pipeline_layout) {
+        evict_pipelines(reinterpret_cast<uint64_t>(pipeline_layout));
+        defer_deletion(VK_OBJECT_TYPE_PIPELINE_LAYOUT, reinterpret_cast<uint64_t>(pipeline_layout));
+    }
+
+    void VulkanContext::evict_pipelines(uint64_t handle) {
+        //a recycled layout or render pass handle must not hit pipelines built for the old object.
+        for (VkPipeline pipeline : pipeline_state_cache.evict(handle)) {
+            defer_deletion(VK_OBJECT_TYPE_PIPELINE, reinterpret_cast<uint64_t>(pipeline));
+        }
+    }
+
+    void VulkanContext::destroy_deferred(const VulkanImage& image) {
+        if (image.sampler != VK_NULL_HANDLE) {
+            destroy_deferred(image.sampler);
+        }
+        if (image.image_view != VK_NULL_HANDLE) {
+            destroy_deferred(image.image_view);
+        }
+        if (image.image != VK_NULL_HANDLE) {
+            destroy_deferred(image.image, image.allocation);
+        }
+    }
+
+    void VulkanContext::defer_deletion(VkObjectType type, uint64_t handle, VmaAllocation allocation) {
+        PendingDeletion pending{};
+        pending.frame_number = frame_number;
+        pending.type = type;
+        pending.handle = handle;
+        pending.allocation = allocation;
+        deletion_queue.push_back(pending);
+    }
+
+    void VulkanContext::flush_deletion_queue(bool force) {
+        //entries are tagged in submission order, so the queue only has to be drained from the front.
+        while (!deletion_queue.empty()) {
+            const PendingDeletion& pending = deletion_queue.front();
+
+            //frame N reuses the slot of frame N - frames_in_flight, whose fence has been waited on.
+            if (!force && frame_number < pending.frame_number + frames.size()) {
+                break;
+            }
+
+            switch (pending.type) {
+                case VK_OBJECT_TYPE_BUFFER:
+                    vmaDestroyBuffer(allocator, reinterpret_cast<VkBuffer>(pending.handle), pending.allocation);
+                    break;
+                case VK_OBJECT_TYPE_IMAGE:
+                    vmaDestroyImage(allocator, reinterpret_cast<VkImage>(pending.handle), pending.allocation);
+                    break;
+                case VK_OBJECT_TYPE_IMAGE_VIEW:
+                    vkDestroyImageView(device, reinterpret_cast<VkImageView>(pending.handle), nullptr);
+                    break;
+                case VK_OBJECT_TYPE_SAMPLER:
+                    vkDestroySampler(device, reinterpret_cast<VkSampler>(pending.handle), nullptr);
+                    break;
+                case VK_OBJECT_TYPE_FRAMEBUFFER:
+                    vkDestroyFramebuffer(device, reinterpret_cast<VkFramebuffer>(pending.handle), nullptr);
+                    break;
+                case VK_OBJECT_TYPE_RENDER_PASS:
+                    vkDestroyRenderPass(device, reinterpret_cast<VkRenderPass>(pending.handle), nullptr);
+                    break;
+                case VK_OBJECT_TYPE_PIPELINE:
+                    vkDestroyPipeline(device, reinterpret_cast<VkPipeline>(pending.handle), nullptr);
+                    break;
+                case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+                    vkDestroyPipelineLayout(device, reinterpret_cast<VkPipelineLayout>(pending.handle), nullptr);
+                    break;
+                case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+                    vkDestroySwapchainKHR(device, reinterpret_cast<VkSwapchainKHR>(pending.handle), nullptr);
+                    break;
+                default:
+                    vmaFreeMemory(allocator, pending.allocation);
+                    break;
+            }
+            deletion_queue.pop_front();
+        }
+    }
+
+    bool RenderTargetDesc::operator==(const RenderTargetDesc& other) const {
+        return color_formats == other.color_formats && depth_format == other.depth_format && samples == other.samples &&
+               size.width == other.size.width && size.height == other.size.height && sampled_depth == other.sampled_depth;
+    }
+
+    size_t RenderTargetDesc::hash() const {
+        size_t seed = 0;
+        for (auto format : color_formats) {
+            hash_combine(seed, static_cast<uint32_t>(format));
+        }
+        hash_combine(seed, static_cast<uint32_t>(depth_format));
+        hash_combine(seed, static_cast<uint32_t>(samples));
+        hash_combine(seed, size.width);
+        hash_combine(seed, size.height);
+        hash_combine(seed, sampled_depth);
+        return seed;
+    }
+
+    const VulkanRenderTarget& VulkanContext::create_render_target(const RenderTargetDesc& desc) {
+        auto it = render_targets.find(desc);
+        if (it != render_targets.end()) {
+            VulkanRenderTarget& target = it->second;
+            bool follows_extent = desc.size.width == 0 && desc.size.height == 0;
+            if (follows_extent && (target.extent.width != static_cast<uint32_t>(extent.x) || target.extent.height != static_cast<uint32_t>(extent.y))) {
+                destroy_render_target(target);
+                build_render_target(desc, target);
+            }
+            return target;
+        }
+
+        VulkanRenderTarget& target = render_targets[desc];
+        build_render_target(desc, target);
+        return target;
+    }
+
+    VkRenderPass VulkanContext::get_render_target_pass(const RenderTargetDesc& desc) {
+        RenderTargetDesc key = desc;
+        key.size = {0, 0};
+
+        auto it = render_target_passes.find(key);
+        if (it != render_target_passes.end()) {
+            return it->second;
+        }
+
+        //multisampled colors are resolved at the end of the pass, only the resolves are kept and sampled.
+        bool multisampled = desc.samples != VK_SAMPLE_COUNT_1_BIT;
+        std::vector<VkAttachmentDescription> attachments;
+        std::vector<VkAttachmentReference> color_references;
+        std::vector<VkAttachmentReference> resolve_references;
+        VkAttachmentReference depth_reference{};
+
+        for (auto format : desc.color_formats) {
+            VkAttachmentDescription attachment{};
+            attachment.format = format;
+            attachment.samples = desc.samples;
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            attachment.finalLayout = multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            color_references.push_back({static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+            attachments.push_back(attachment);
+        }
+
+        if (desc.depth_format != VK_FORMAT_UNDEFINED) {
+            bool has_stencil = get_format_aspect(desc.depth_format) & VK_IMAGE_ASPECT_STENCIL_BIT;
+            VkAttachmentDescription attachment{};
+            attachment.format = desc.depth_format;
+            attachment.samples = desc.samples;
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachment.storeOp = desc.sampled_depth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.stencilLoadOp = has_stencil ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = has_stencil ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            attachment.finalLayout = desc.sampled_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            depth_reference = {static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+            attachments.push_back(attachment);
+        }
+
+        if (multisampled) {
+            for (auto format : desc.color_formats) {
+                VkAttachmentDescription attachment{};
+                attachment.format = format;
+                attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+                attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+                attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                resolve_references.push_back({static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+                attachments.push_back(attachment);
+            }
+        }
+
+        VkSubpassDescription sub_pass{};
+        sub_pass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        sub_pass.colorAttachmentCount = color_references.size();
+        sub_pass.pColorAttachments = color_references.data();
+        sub_pass.pResolveAttachments = multisampled ? resolve_references.data() : nullptr;
+        sub_pass.pDepthStencilAttachment = desc.depth_format != VK_FORMAT_UNDEFINED ? &depth_reference : nullptr;
+
+        //the frame samples the target after the pass, the next use of the slot's images waits for those reads.
+        VkSubpassDependency dependencies[2]{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        //transient attachments are shared between frames, earlier frames' writes to them are waited on too.
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                       VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                       VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        VkRenderPassCreateInfo render_pass_info{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+        render_pass_info.attachmentCount = attachments.size();
+        render_pass_info.pAttachments = attachments.data();
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &sub_pass;
+        render_pass_info.dependencyCount = 2;
+        render_pass_info.pDependencies = dependencies;
+
+        VkRenderPass render_pass{};
+        if (vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass) != VK_SUCCESS) {
+            spdlog::error("[VulkanContext] failed to create render target render pass");
+            return VK_NULL_HANDLE;
+        }
+        render_target_passes.emplace(key, render_pass);
+        return render_pass;
+    }
+
+    void VulkanContext::build_render_target(const RenderTargetDesc& desc, VulkanRenderTarget& target) {
+        bool multisampled = desc.samples != VK_SAMPLE_COUNT_1_BIT;
+        bool follows_extent = desc.size.width == 0 && desc.size.height == 0;
+        VkExtent3D image_extent{follows_extent ? static_cast<uint32_t>(extent.x) : desc.size.width,
+                                follows_extent ? static_cast<uint32_t>(extent.y) : desc.size.height, 1};
+
+        target.vk_render_pass = get_render_target_pass(desc);
+        target.extent = {image_extent.width, image_extent.height};
+        target.color_count = desc.color_formats.size();
+        target.has_depth = desc.depth_format != VK_FORMAT_UNDEFINED;
+        target.sampled_depth = target.has_depth && desc.sampled_depth;
+        target.attachments.resize(frames.size());
+        //imageless mode shares one framebuffer between the frames, each frame passes its own views.
+        target.framebuffers.resize(settings.imageless_framebuffers ? 1 : frames.size());
+
+        //attachments nothing reads after the pass only live in tile memory, one copy serves every frame in flight.
+        std::vector<VulkanImage> transient_colors;
+        VulkanImage transient_depth{};
+        if (multisampled) {
+            for (auto format : desc.color_formats) {
+                transient_colors.push_back(create_transient_attachment(format, image_extent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, desc.samples));
+            }
+        }
+        if (target.has_depth && !desc.sampled_depth) {
+            transient_depth = create_transient_attachment(desc.depth_format, image_extent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, desc.samples);
+        }
+
+        //the sampled images get one set per frame in flight so a frame never renders into images an older frame still samples.
+        for (size_t i = 0; i < frames.size(); ++i) {
+            std::vector<VulkanImage>& attachments = target.attachments[i];
+            if (multisampled) {
+                attachments = transient_colors;
+            } else {
+                for (auto format : desc.color_formats) {
+                    attachments.push_back(create_image(format, image_extent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+                }
+            }
+            if (target.has_depth) {
+                attachments.push_back(desc.sampled_depth ?
+                                      create_image(desc.depth_format, image_extent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, desc.samples) :
+                                      transient_depth);
+            }
+            if (multisampled) {
+                for (auto format : desc.color_formats) {
+                    attachments.push_back(create_image(format, image_extent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+                }
+            }
+
+            if (i < target.framebuffers.size()) {
+                target.framebuffers[i] = create_framebuffer(target.vk_render_pass, attachments, target.extent, settings.imageless_framebuffers);
+            }
+        }
+    }
+
+    VulkanImage VulkanContext::create_transient_attachment(VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkSampleCountFlagBits samples) {
+        usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+        VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = format;
+        image_info.extent = extent;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = samples;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = usage;
+
+        //desktop GPUs have no lazily allocated memory type, the transient usage is then only a hint.
+        VmaAllocationCreateInfo alloc_info{};
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+        uint32_t memory_type_index = 0;
+        if (vmaFindMemoryTypeIndexForImageInfo(allocator, &image_info, &alloc_info, &memory_type_index) == VK_SUCCESS) {
+            VulkanImage image = create_image(format, extent, usage, samples, VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED);
+            if (image.image != VK_NULL_HANDLE) {
+                return image;
+            }
+        }
+        return create_image(format, extent, usage, samples);
+    }
+
+    void VulkanContext::destroy_render_target(VulkanRenderTarget& target) {
+        for (auto framebuffer : target.framebuffers) {
+            destroy_deferred(framebuffer);
+        }
+        //transient attachments appear in every frame's set, destroy them once.
+        std::unordered_set<VkImage> destroyed;
+        for (auto& attachments : target.attachments) {
+            for (auto& attachment : attachments) {
+                if (destroyed.insert(attachment.image).second) {
+                    destroy_deferred(attachment);
+                }
+            }
+        }
+        target.framebuffers.clear();
+        target.attachments.clear();
+    }
+
+    VkCommandBuffer VulkanContext::begin_render_target(const VulkanRenderTarget& target, const std::vector<VkClearValue>& clear_values,
+                                                       VkSubpassContents contents) {
+        if (!recording_frame || swapchain_pass_active) {
+            spdlog::error("[VulkanContext] render targets have to be recorded inside a frame, before the swapchain pass");
+            return VK_NULL_HANDLE;
+        }
+
+        //unspecified clears default to black and the far plane.
+        uint32_t attachment_count = target.attachments[current_frame].size();
+        std::vector<VkClearValue> clears(attachment_count);
+        for (uint32_t i = 0; i < attachment_count; ++i) {
+            if (i < clear_values.size()) {
+                clears[i] = clear_values[i];
+            } else if (target.has_depth && i == target.color_count) {
+                clears[i].depthStencil = {1.f, 0};
+            }
+        }
+
+        glm::ivec2 size{static_cast<int>(target.extent.width), static_cast<int>(target.extent.height)};
+        if (settings.imageless_framebuffers) {
+            std::vector<VkImageView> image_views;
+            for (auto& attachment : target.attachments[current_frame]) {
+                image_views.push_back(attachment.image_view);
+            }
+            begin_render_pass(target.vk_render_pass, target.framebuffers[0], size, clears.data(), attachment_count,
+                              image_views.data(), image_views.size(), contents, "render target");
+        } else {
+            begin_render_pass(target.vk_render_pass, target.framebuffers[current_frame], size, clears.data(), attachment_count,
+                              nullptr, 0, contents, "render target");
+        }
+        return frames[current_frame].command_buffer;
+    }
+
+    void VulkanContext::end_render_target() {
+        end_render_pass();
+    }
+
+    const VulkanImage& VulkanContext::get_render_target_color(const VulkanRenderTarget& target, uint32_t index) const {
+        if (index >= target.color_count) {
+            spdlog::error("[VulkanContext] render target has no color attachment {}", index);
+            return NULL_IMAGE;
+        }
+        const std::vector<VulkanImage>& attachments = target.attachments[current_frame];
+        //resolves sit after the colors and the depth
+        bool multisampled = attachments.size() > target.color_count + (target.has_depth ? 1 : 0);
+        return multisampled ? attachments[target.color_count + (target.has_depth ? 1 : 0) + index] : attachments[index];
+    }
+
+    const VulkanImage& VulkanContext::get_render_target_depth(const VulkanRenderTarget& target) const {
+        //without sampled_depth the depth is transient, it has no sampled usage and nothing survives the pass.
+        if (!target.has_depth || !target.sampled_depth) {
+            spdlog::error("[VulkanContext] render target has no sampled depth");
+            return NULL_IMAGE;
+        }
+        return target.attachments[current_frame][target.color_count];
+    }
+
+    void VulkanContext::begin_render_pass(VkRenderPass render_pass, VkFramebuffer framebuffer, glm::ivec2 size,
+                                          const VkClearValue* clear_values, uint32_t clear_value_count,
+                                          const VkImageView* attachment_views, uint32_t attachment_view_count,
+                                          VkSubpassContents contents, const char* region_name) {
+        //opened outside the pass so the attachment loads and stores are timed with it.
+        uint32_t gpu_region = gpu_profiler.begin_region(frames[current_frame].command_buffer, region_name);
 
         VkRenderPassBeginInfo render_pass_info{};
         render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -305,39 +1935,67 @@ namespace vk_sandbox {
         render_pass_info.renderArea.offset = {0, 0};
         render_pass_info.renderArea.extent = {static_cast<uint32_t>(size.x), static_cast<uint32_t>(size.y)};
 
-        VkClearValue clear_value{};
-        clear_value.color = {0.2f, 0.3f, 0.3f, 1.0f};
-
-        render_pass_info.clearValueCount = 1;
-        render_pass_info.pClearValues = &clear_value;
+        render_pass_info.clearValueCount = clear_value_count;
+        render_pass_info.pClearValues = clear_values;
 
-        vkCmdBeginRenderPass(cmds[image_index], &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        VkRenderPassAttachmentBeginInfo attachment_begin_info{VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO};
+        if (attachment_views != nullptr) {
+            attachment_begin_info.attachmentCount = attachment_view_count;
+            attachment_begin_info.pAttachments = attachment_views;
+            render_pass_info.pNext = &attachment_begin_info;
+        }
 
-        VkViewport vk_viewport;
-        vk_viewport.x = 0;
-        vk_viewport.y = size.y;
-        vk_viewport.width = size.x;
-        vk_viewport.height = -size.y;
+        vkCmdBeginRenderPass(frames[current_frame].command_buffer, &render_pass_info, contents);
+        active_pass = {render_pass, framebuffer, size, contents, gpu_region};
 
-        vk_viewport.minDepth = 0.0f;
-        vk_viewport.maxDepth = 1.f;
-        vkCmdSetViewport(cmds[image_index], 0, 1, &vk_viewport);
+        //secondaries don't inherit dynamic state, record_parallel sets it in each of them instead.
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+            set_viewport(frames[current_frame].command_buffer, size);
+        }
+    }
 
-        VkRect2D rect_2d;
-        rect_2d.offset.x = 0;
-        rect_2d.offset.y = 0;
-        rect_2d.extent.width = static_cast<uint32_t>(size.x);
-        rect_2d.extent.height = static_cast<uint32_t>(size.y);
-        vkCmdSetScissor(cmds[image_index], 0, 1, &rect_2d);
+    void VulkanContext::end_render_pass() {
+        vkCmdEndRenderPass(frames[current_frame].command_buffer);
+        gpu_profiler.end_region(frames[current_frame].command_buffer, active_pass.gpu_region);
+        active_pass = {};
     }
 
     void VulkanContext::destroy_vulkan() {
         vkDeviceWaitIdle(device);
 
-        for (auto i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
-            vkDestroySemaphore(device, render_finished_semaphores[i], nullptr);
-            vkDestroyFence(device, in_flight_fences[i], nullptr);
+        for (auto& frame : frames) {
+            vmaDestroyBuffer(allocator, frame.staging_buffer.buffer, frame.staging_buffer.allocation);
+            vkDestroySemaphore(device, frame.image_available_semaphore, nullptr);
+            vkDestroySemaphore(device, frame.render_finished_semaphore, nullptr);
+            vkDestroyFence(device, frame.in_flight_fence, nullptr);
+            vkDestroyCommandPool(device, frame.command_pool, nullptr);
+            if (frame.transfer_command_pool != VK_NULL_HANDLE) {
+                vkDestroySemaphore(device, frame.upload_finished_semaphore, nullptr);
+                vkDestroyCommandPool(device, frame.transfer_command_pool, nullptr);
+            }
+            vkDestroySemaphore(device, frame.compute_finished_semaphore, nullptr);
+            vkDestroyCommandPool(device, frame.compute_command_pool, nullptr);
+            for (auto& secondary_pool : frame.secondary_command_pools) {
+                vkDestroyCommandPool(device, secondary_pool, nullptr);
+            }
+            frame.descriptor_allocator.destroy();
+        }
+
+        for (auto& render_target : render_targets) {
+            destroy_render_target(render_target.second);
+        }
+        for (auto& render_pass : render_target_passes) {
+            destroy_deferred(render_pass.second);
+        }
+        render_targets.clear();
+        render_target_passes.clear();
+
+        flush_deletion_queue(true);
+
+        for (auto& timeline : timelines) {
+            if (timeline.semaphore != VK_NULL_HANDLE) {
+                vkDestroySemaphore(device, timeline.semaphore, nullptr);
+            }
         }
 
         for (int i = 0; i < swapchain_framebuffers.size(); ++i) {
@@ -348,14 +2006,33 @@ namespace vk_sandbox {
 
         for (int i = 0; i < images.size(); ++i) {
             vkDestroyImageView(device, images[i].image_view, nullptr);
+            if (images[i].allocation) {
+                vmaDestroyImage(allocator, images[i].image, images[i].allocation);
+            }
         }
 
-        vkDestroySwapchainKHR(device, swapchain_khr, nullptr);
-        vkDestroySurfaceKHR(instance, surface_khr, nullptr);
+        if (!settings.headless) {
+            vkDestroySwapchainKHR(device, swapchain_khr, nullptr);
+            vkDestroySurfaceKHR(instance, surface_khr, nullptr);
+        }
 
         vkFreeCommandBuffers(device, command_pool, 1, &temporary_command_buffer);
         vkDestroyCommandPool(device, command_pool, nullptr);
-        vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+        pipeline_state_cache.destroy();
+        for (auto& shader_module : shader_modules) {
+            vkDestroyShaderModule(device, shader_module.second.module, nullptr);
+        }
+        shader_modules.clear();
+        recording_pool.destroy();
+        gpu_profiler.destroy();
+        save_pipeline_cache();
+        vkDestroyPipelineCache(device, pipeline_cache, nullptr);
+
+        descriptor_cache.destroy();
+        if (settings.bindless) {
+            bindless_table.destroy();
+        }
+        descriptor_allocator.destroy();
         vmaDestroyAllocator(allocator);
         vkDestroyDevice(device, nullptr);
         vkb::destroy_debug_utils_messenger(instance, debug_messenger);
@@ -9,21 +9,152 @@
 #include <GLFW/glfw3.h>
 
 #include <vector>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
 #include <glm/glm.hpp>
 #include "vulkan_types.hpp"
+#include "descriptor_cache.hpp"
+#include "bindless_table.hpp"
+#include "pipeline_builder.hpp"
+#include "thread_pool.hpp"
+#include "gpu_profiler.hpp"
 
 namespace vk_sandbox {
 
     class VulkanContext {
     public:
-        void init_vulkan();
+        void init_vulkan(const VulkanContextSettings& settings = {});
         void destroy_vulkan();
         void create_swapchain(GLFWwindow* window, bool vsync);
+        void create_headless(glm::ivec2 size);
         bool begin_frame(glm::ivec2 size);
         void end_frame();
 
-        VulkanRenderTarget create_render_target();
+        //cached by description, call it every frame: targets following the swapchain extent are rebuilt on resize,
+        //keeping their render pass. Attachments are duplicated per frame in flight.
+        const VulkanRenderTarget& create_render_target(const RenderTargetDesc& desc);
+        //records the target's pass into the frame, has to come before the swapchain pass begins.
+        VkCommandBuffer begin_render_target(const VulkanRenderTarget& target, const std::vector<VkClearValue>& clear_values = {},
+                                            VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+        void end_render_target();
+        //this frame's shader readable copy of a color attachment (its resolve when multisampled) or of the depth.
+        const VulkanImage& get_render_target_color(const VulkanRenderTarget& target, uint32_t index) const;
+        const VulkanImage& get_render_target_depth(const VulkanRenderTarget& target) const;
+
+        VulkanImage create_image(VkFormat format, VkExtent3D extent, VkImageUsageFlags usage,
+                                 VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT,
+                                 VmaMemoryUsage memory_usage = VMA_MEMORY_USAGE_GPU_ONLY);
+
+        VulkanBuffer create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VulkanBufferMemory memory);
+        void* map_buffer(const VulkanBuffer& buffer);
+        void flush_buffer(const VulkanBuffer& buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        void invalidate_buffer(const VulkanBuffer& buffer, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        void destroy_buffer(VulkanBuffer& buffer);
+
+        //stage data in the current frame's upload ring, the copies run in one batch before the frame's commands.
+        void upload_buffer(const VulkanBuffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+        void upload_image(const VulkanImage& dst, const void* data, VkDeviceSize size,
+                          VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        //persistent sets live until destroy_vulkan, frame sets are recycled once the frame's slot comes around again.
+        VkDescriptorSet allocate_descriptor_set(VkDescriptorSetLayout layout);
+        VkDescriptorSet allocate_frame_descriptor_set(VkDescriptorSetLayout layout);
+
+        //layouts shared by bindings and immutable sets shared by the resources they bind.
+        VkDescriptorSetLayout get_descriptor_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+        VkDescriptorSet get_descriptor_set(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+        //forgets every cached descriptor set, resources destroyed through destroy_deferred are evicted on their own.
+        void invalidate_descriptor_sets();
+        const DescriptorCacheStats& get_descriptor_cache_stats() const { return descriptor_cache.get_stats(); }
+
+        //bindless mode, shaders index the global table with the returned handle instead of binding sets per draw.
+        uint32_t register_bindless_texture(const VulkanImage& image, VkImageLayout image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        uint32_t register_bindless_buffer(const VulkanBuffer& buffer);
+        void release_bindless_texture(uint32_t handle);
+        void release_bindless_buffer(uint32_t handle);
+        void bind_bindless_set(VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout pipeline_layout, uint32_t set_index = 0);
+        VkDescriptorSetLayout get_bindless_layout() const { return bindless_table.get_layout(); }
+
+        VkPipelineCache get_pipeline_cache() const { return pipeline_cache; }
+
+        //pipelines are shared by description and live until their layout or render pass goes through destroy_deferred,
+        //safe to request from worker threads.
+        VkPipeline get_graphics_pipeline(const GraphicsPipelineDesc& desc);
+        //compiles in the background, draws get fallback (null to skip the draw) until the pipeline is ready.
+        VkPipeline request_graphics_pipeline(const GraphicsPipelineDesc& desc, VkPipeline fallback = VK_NULL_HANDLE);
+        size_t get_pending_pipeline_count() { return pipeline_state_cache.get_pending_count(); }
+        //the same SPIR-V always returns the same module, it stays alive until destroy_vulkan.
+        VkShaderModule create_shader_module(const uint32_t* code, size_t size);
+        void destroy_shader_module(VkShaderModule shader_module);
+        VkRenderPass get_render_pass() const { return swapchain_renderpass; }
+
+        //imageless framebuffers only bake in the attachments' format, usage and size, the views are bound at begin.
+        bool uses_imageless_framebuffers() const { return settings.imageless_framebuffers; }
+        VkFramebuffer create_framebuffer(VkRenderPass render_pass, const std::vector<VulkanImage>& attachments, VkExtent2D size, bool imageless);
+
+        //async compute for the current frame, the graphics submission waits for it at graphics_wait_stage.
+        VkCommandBuffer begin_compute();
+        void dispatch(VkPipeline pipeline, VkPipelineLayout layout, const std::vector<VkDescriptorSet>& descriptor_sets, glm::uvec3 group_count);
+        void submit_compute(VkPipelineStageFlags graphics_wait_stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                                                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        //release handles the GPU may still reference, they are destroyed once the current frame has completed.
+        void destroy_deferred(VkBuffer buffer, VmaAllocation allocation);
+        void destroy_deferred(VkImage image, VmaAllocation allocation);
+        void destroy_deferred(VmaAllocation allocation);
+        void destroy_deferred(VkImageView image_view);
+        void destroy_deferred(VkSampler sampler);
+        void destroy_deferred(VkFramebuffer framebuffer);
+        void destroy_deferred(VkRenderPass render_pass);
+        void destroy_deferred(VkPipeline pipeline);
+        void destroy_deferred(VkPipelineLayout pipeline_layout);
+        void destroy_deferred(const VulkanImage& image);
+
+        bool is_headless() const { return settings.headless; }
+        const VkPhysicalDeviceProperties& get_gpu_properties() const { return gpu_properties; }
+        glm::ivec2 get_extent() const { return extent; }
+        VkDevice get_device() const { return device; }
+        uint32_t get_graphics_queue_family() const { return graphics_queue_family; }
+        VmaAllocator get_allocator() const { return allocator; }
+        uint64_t get_frame_number() const { return frame_number; }
+        size_t get_frames_in_flight() const { return frames.size(); }
+
+        //records inside the swapchain render pass, which begins on first use unless the backbuffer was already written.
+        VkCommandBuffer get_command_buffer();
+        //records outside any render pass, for work that has to come before the swapchain pass.
+        VkCommandBuffer get_frame_command_buffer() const { return frames[current_frame].command_buffer; }
+
+        //records task_count secondaries across the recording threads and executes them in task order inside the active
+        //render pass. Without one the swapchain pass begins with secondary contents, a pass begun inline can't take them.
+        //Each secondary has the viewport and scissor set, record is called concurrently from several threads.
+        void record_parallel(uint32_t task_count, const std::function<void(uint32_t task, VkCommandBuffer cmd)>& record);
+        uint32_t get_recording_thread_count() const { return recording_pool.get_slot_count(); }
+
+        //the frame, the swapchain pass ("swapchain"), render targets ("render target") and render graph passes are timed,
+        //GpuProfiler::Scope adds user regions in primary command buffers.
+        GpuProfiler& get_gpu_profiler() { return gpu_profiler; }
+        const std::vector<GpuTiming>& get_gpu_timings() const { return gpu_profiler.get_timings(); }
+        double get_gpu_milliseconds(const std::string& name) const { return gpu_profiler.get_milliseconds(name); }
+        //CPU time the last frame spent blocked on its slot and image fences, and in vkQueuePresentKHR.
+        double get_fence_wait_milliseconds() const { return fence_wait_milliseconds; }
+        double get_present_milliseconds() const { return present_milliseconds; }
+
+        //the image presented this frame, a render graph that writes it leaves it in the final layout itself.
+        const VulkanImage& get_backbuffer() const { return images[image_index]; }
+        VkImageLayout get_backbuffer_final_layout() const { return settings.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+        void mark_backbuffer_written() { backbuffer_written = true; }
+        bool has_dedicated_transfer_queue() const { return transfer_queue_family != graphics_queue_family; }
+        bool has_async_compute_queue() const { return compute_queue_family != graphics_queue_family; }
+
+        //timeline mode, every submission to a queue bumps its timeline, any subsystem can poll or wait on a value.
+        bool uses_timeline_semaphores() const { return settings.timeline_semaphores; }
+        uint64_t get_timeline_value(VulkanQueueType queue) const { return timelines[static_cast<size_t>(queue)].value; }
+        uint64_t get_completed_timeline_value(VulkanQueueType queue);
+        bool is_timeline_complete(VulkanQueueType queue, uint64_t value);
+        void wait_timeline(VulkanQueueType queue, uint64_t value, uint64_t timeout = UINT64_MAX);
     private:
+        VulkanContextSettings settings{};
         vkb::Instance instance_builder{};
         VkInstance instance{};
         VkDebugUtilsMessengerEXT debug_messenger{};
@@ -31,30 +162,102 @@ namespace vk_sandbox {
         VkPhysicalDeviceProperties gpu_properties{};
         VkDevice device{};
         VmaAllocator allocator{};
+        VkPipelineCache pipeline_cache{};
         VkQueue graphics_queue{};
         uint32_t graphics_queue_family{};
         VkQueue present_queue{};
+        VkQueue transfer_queue{};
+        uint32_t transfer_queue_family{};
+        VkQueue compute_queue{};
+        uint32_t compute_queue_family{};
         VkCommandPool command_pool{};
         VkCommandBuffer temporary_command_buffer{};
-        VkDescriptorPool descriptor_pool{};
+        DescriptorAllocator descriptor_allocator{};
+        DescriptorCache descriptor_cache{};
+        BindlessTable bindless_table{};
+        PipelineStateCache pipeline_state_cache{};
+        //pipelines are keyed on module handles, so modules live as long as the pipeline cache and identical SPIR-V shares one
+        struct CachedShaderModule {
+            std::vector<uint32_t> code;
+            VkShaderModule module{};
+        };
+        std::unordered_multimap<size_t, CachedShaderModule> shader_modules;
+        ThreadPool recording_pool{};
+        GpuProfiler gpu_profiler{};
+        uint32_t frame_region{INVALID_GPU_REGION};
+        double fence_wait_milliseconds{};
+        double present_milliseconds{};
+
+        //offscreen targets
+        struct RenderTargetHash {
+            size_t operator()(const RenderTargetDesc& desc) const { return desc.hash(); }
+        };
+        std::unordered_map<RenderTargetDesc, VulkanRenderTarget, RenderTargetHash> render_targets;
+        //keyed by the description without its size, shared by every size of a target
+        std::unordered_map<RenderTargetDesc, VkRenderPass, RenderTargetHash> render_target_passes;
 
         //swap chain
         uint32_t image_index{0};
         VkSurfaceKHR surface_khr{};
         VkSwapchainKHR swapchain_khr{};
-        std::vector<VkCommandBuffer> cmds;
         std::vector<VulkanImage> images;
-        VkRenderPass swapchain_renderpass;
+        VkRenderPass swapchain_renderpass{};
         std::vector<VkFramebuffer> swapchain_framebuffers;
+        glm::ivec2 extent{};
+        glm::ivec2 requested_extent{};
+        bool vsync{true};
+        bool swapchain_dirty{false};
 
-        //sync
+        //frames in flight
         size_t current_frame = 0;
+        uint64_t frame_number = 0;
+        bool recording_frame{false};
+        bool swapchain_pass_active{false};
+        bool backbuffer_written{false};
+        //render pass currently recording in the frame command buffer, secondaries inherit it
+        struct ActivePass {
+            VkRenderPass render_pass{};
+            VkFramebuffer framebuffer{};
+            glm::ivec2 size{};
+            VkSubpassContents contents{VK_SUBPASS_CONTENTS_INLINE};
+            uint32_t gpu_region{INVALID_GPU_REGION};
+        } active_pass{};
+        std::vector<VkCommandBuffer> parallel_command_buffers;
+        std::vector<VulkanFrame> frames;
         std::vector<VkFence> images_in_flight{};
-        std::vector<VkSemaphore> image_available_semaphores;
-        std::vector<VkSemaphore> render_finished_semaphores;
-        std::vector<VkFence> in_flight_fences;
+        std::vector<uint64_t> images_in_flight_values{};
+        std::array<VulkanTimeline, 3> timelines{};
+        std::deque<PendingDeletion> deletion_queue;
+        std::vector<VkBufferCopy> copy_regions;
+        std::vector<VkBuffer> uploaded_buffers;
+        //destinations uploaded at least once: frames in flight may read them, so later uploads stay on the graphics queue
+        std::unordered_set<uint64_t> uploaded_resources;
 
 
-        void begin_render_pass(VkRenderPass render_pass, VkFramebuffer framebuffer, glm::ivec2 size);
+        void create_frames();
+        void load_pipeline_cache();
+        void save_pipeline_cache();
+        void create_timelines();
+        uint64_t submit(VulkanQueueType queue, VkSubmitInfo submit_info, const uint64_t* wait_values, VkFence fence);
+        //offset of the data in this frame's upload ring, UINT64_MAX when the ring could not grow to fit it
+        VkDeviceSize stage_upload(const void* data, VkDeviceSize size);
+        bool record_uploads(VulkanFrame& frame);
+        bool build_swapchain(glm::ivec2 size);
+        void defer_deletion(VkObjectType type, uint64_t handle, VmaAllocation allocation = {});
+        void flush_deletion_queue(bool force);
+        void create_swapchain_renderpass(VkImageLayout final_layout);
+        void create_framebuffers();
+        void begin_render_pass(VkRenderPass render_pass, VkFramebuffer framebuffer, glm::ivec2 size,
+                               const VkClearValue* clear_values, uint32_t clear_value_count,
+                               const VkImageView* attachment_views = nullptr, uint32_t attachment_view_count = 0,
+                               VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE, const char* region_name = "render pass");
+        void end_render_pass();
+        void begin_swapchain_pass(VkSubpassContents contents);
+        VkCommandBuffer acquire_secondary_command_buffer(VulkanFrame& frame, uint32_t slot);
+        VkRenderPass get_render_target_pass(const RenderTargetDesc& desc);
+        void build_render_target(const RenderTargetDesc& desc, VulkanRenderTarget& target);
+        void evict_pipelines(uint64_t handle);
+        VulkanImage create_transient_attachment(VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkSampleCountFlagBits samples);
+        void destroy_render_target(VulkanRenderTarget& target);
     };
 }
\ No newline at end of file
@@ -1,12 +1,53 @@
 #pragma once
 
 #include "volk.h"
+#include "descriptor_allocator.hpp"
 #include <vector>
+#include <string>
+#include <deque>
+#include <array>
 
 namespace vk_sandbox {
 
     const int MAX_FRAMES_IN_FLIGHT = 2;
 
+    struct VulkanContextSettings {
+        //render into offscreen images instead of a window surface
+        bool headless{false};
+        //number of frames the CPU may record ahead of the GPU
+        uint32_t frames_in_flight{MAX_FRAMES_IN_FLIGHT};
+        //initial size of each frame's staging ring, it grows when a frame uploads more
+        VkDeviceSize upload_ring_size{16 * 1024 * 1024};
+        //pace frames and cross-queue waits with one Vulkan 1.2 timeline semaphore per queue instead of fences
+        bool timeline_semaphores{false};
+        //Vulkan 1.2 descriptor indexing, one global texture/buffer table indexed by integer handles
+        bool bindless{false};
+        uint32_t bindless_capacity{16384};
+        //pipeline cache blob loaded at init and saved at shutdown, empty disables persistence
+        std::string pipeline_cache_path{"pipeline_cache.bin"};
+        //worker threads compiling requested pipelines off the frame, 0 compiles them on the caller.
+        uint32_t pipeline_compile_threads{2};
+        //Vulkan 1.2 imageless framebuffers, one framebuffer per attachment combination and size instead of per image view
+        bool imageless_framebuffers{false};
+        //worker threads recording secondary command buffers next to the main thread, 0 records everything on the caller.
+        uint32_t recording_threads{3};
+        //timestamp queries around frames, passes and user regions, read back frames_in_flight frames later
+        bool gpu_profiling{true};
+        uint32_t gpu_profiler_max_regions{256};
+    };
+
+    enum class VulkanQueueType {
+        graphics,
+        compute,
+        transfer
+    };
+
+    struct VulkanTimeline {
+        VkSemaphore semaphore{};
+        //last value handed to a submission, the GPU counter catches up to it
+        uint64_t value{};
+    };
+
     struct VulkanImage {
         VkFormat image_format{};
         VkImage image{};
@@ -14,11 +55,135 @@ namespace vk_sandbox {
         VkSampler sampler{};
         VmaAllocation allocation{};
         VkExtent3D extent{};
+        //needed to describe the image to imageless framebuffers, 0 when unknown
+        VkImageUsageFlags usage{};
+    };
+
+    inline VkImageAspectFlags get_format_aspect(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_D16_UNORM:
+            case VK_FORMAT_X8_D24_UNORM_PACK32:
+            case VK_FORMAT_D32_SFLOAT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+            case VK_FORMAT_D16_UNORM_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+            case VK_FORMAT_S8_UINT:
+                return VK_IMAGE_ASPECT_STENCIL_BIT;
+            default:
+                return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+
+    enum class VulkanBufferMemory {
+        //GPU only, filled through transfers (vertex, index, static storage data)
+        device_local,
+        //persistently mapped and written by the CPU (uniforms, dynamic data, staging)
+        host_visible,
+        //written by the GPU and read back by the CPU
+        readback
+    };
+
+    struct VulkanBuffer {
+        VkBuffer buffer{};
+        VmaAllocation allocation{};
+        VkDeviceSize size{};
+        VulkanBufferMemory memory{};
+        //storage buffers are concurrent across queue families when async compute runs on its own family
+        VkSharingMode sharing_mode{VK_SHARING_MODE_EXCLUSIVE};
+        //persistent mapping, null for device_local buffers
+        void* mapped{};
+    };
+
+    struct PendingBufferCopy {
+        VkBuffer src{};
+        VkBuffer dst{};
+        VkBufferCopy region{};
+        //exclusive destinations need a queue family ownership transfer
+        bool exclusive{true};
+        //first upload of the destination, recorded on the dedicated transfer queue
+        bool transfer_queue{false};
+    };
+
+    struct PendingImageCopy {
+        VkBuffer src{};
+        VkImage dst{};
+        VkBufferImageCopy region{};
+        VkImageLayout final_layout{};
+        bool transfer_queue{false};
+    };
+
+    struct VulkanFrame {
+        VkCommandPool command_pool{};
+        VkCommandBuffer command_buffer{};
+        VkFence in_flight_fence{};
+        VkSemaphore image_available_semaphore{};
+        VkSemaphore render_finished_semaphore{};
+        //timeline mode, graphics timeline value signaled by this slot's last submission
+        uint64_t graphics_timeline_value{};
+
+        //upload ring, linearly suballocated and rewound once the fence signaled
+        VulkanBuffer staging_buffer{};
+        VkDeviceSize staging_offset{};
+        VkCommandBuffer upload_command_buffer{};
+        //only created when uploads run on a dedicated transfer queue family
+        VkCommandPool transfer_command_pool{};
+        VkCommandBuffer transfer_command_buffer{};
+        VkSemaphore upload_finished_semaphore{};
+        bool transfer_uploads{false};
+
+        //async compute, waited on by the frame's graphics submission
+        VkCommandPool compute_command_pool{};
+        VkCommandBuffer compute_command_buffer{};
+        VkSemaphore compute_finished_semaphore{};
+        VkPipelineStageFlags compute_wait_stage{};
+        uint64_t compute_timeline_value{};
+        bool compute_recording{false};
+        bool compute_submitted{false};
+        std::vector<PendingBufferCopy> buffer_copies;
+        std::vector<PendingImageCopy> image_copies;
+
+        //transient descriptor sets, reset wholesale once the fence signaled
+        DescriptorAllocator descriptor_allocator{};
+
+        //one pool per recording thread slot, its secondaries are reused once the fence signaled
+        std::vector<VkCommandPool> secondary_command_pools;
+        std::vector<std::vector<VkCommandBuffer>> secondary_command_buffers;
+        std::vector<uint32_t> secondary_used;
+    };
+
+    struct PendingDeletion {
+        //frame number the handle was released in, it is destroyed once that frame's fence signaled
+        uint64_t frame_number{};
+        VkObjectType type{};
+        uint64_t handle{};
+        VmaAllocation allocation{};
+    };
+
+    //offscreen color/depth target, size {0, 0} follows the swapchain extent.
+    struct RenderTargetDesc {
+        std::vector<VkFormat> color_formats;
+        VkFormat depth_format{VK_FORMAT_UNDEFINED};
+        VkSampleCountFlagBits samples{VK_SAMPLE_COUNT_1_BIT};
+        VkExtent2D size{0, 0};
+        //keep depth after the pass and leave it readable by shaders
+        bool sampled_depth{false};
+
+        bool operator==(const RenderTargetDesc& other) const;
+        size_t hash() const;
     };
 
-    struct VulkanRenderTarget{
-        VkRenderPass vk_render_pass;
+    struct VulkanRenderTarget {
+        VkRenderPass vk_render_pass{};
+        //one framebuffer and attachment set per frame in flight: colors, then depth, then the multisample resolves.
+        //transient attachments (multisampled colors, unsampled depth) are the same image in every set.
         std::vector<VkFramebuffer> framebuffers;
+        std::vector<std::vector<VulkanImage>> attachments;
+        VkExtent2D extent{};
+        uint32_t color_count{};
+        bool has_depth{false};
+        bool sampled_depth{false};
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+//hand assembled SPIR-V 1.0, the benchmarks measure submission cost so the shaders only have to be valid.
+namespace vk_sandbox::benchmark_shaders {
+
+    //void main() { gl_Position = vec4(0.0, 0.0, 0.0, 1.0); }
+    const uint32_t VERTEX[] = {
+        0x07230203, 0x00010000, 0x00000000, 12, 0x00000000,
+        0x00020011, 1,                                          //OpCapability Shader
+        0x0003000E, 0, 1,                                       //OpMemoryModel Logical GLSL450
+        0x0006000F, 0, 1, 0x6E69616D, 0x00000000, 2,            //OpEntryPoint Vertex %1 "main" %2
+        0x00040047, 2, 11, 0,                                   //OpDecorate %2 BuiltIn Position
+        0x00020013, 3,                                          //%3 = OpTypeVoid
+        0x00030021, 4, 3,                                       //%4 = OpTypeFunction %3
+        0x00030016, 5, 32,                                      //%5 = OpTypeFloat 32
+        0x00040017, 6, 5, 4,                                    //%6 = OpTypeVector %5 4
+        0x00040020, 7, 3, 6,                                    //%7 = OpTypePointer Output %6
+        0x0004003B, 7, 2, 3,                                    //%2 = OpVariable %7 Output
+        0x0004002B, 5, 8, 0x00000000,                           //%8 = OpConstant %5 0.0
+        0x0004002B, 5, 9, 0x3F800000,                           //%9 = OpConstant %5 1.0
+        0x0007002C, 6, 10, 8, 8, 8, 9,                          //%10 = OpConstantComposite %6 %8 %8 %8 %9
+        0x00050036, 3, 1, 0, 4,                                 //%1 = OpFunction %3 None %4
+        0x000200F8, 11,                                         //%11 = OpLabel
+        0x0003003E, 2, 10,                                      //OpStore %2 %10
+        0x000100FD,                                             //OpReturn
+        0x00010038,                                             //OpFunctionEnd
+    };
+
+    //layout(location = 0) out vec4 color; void main() { color = vec4(1.0, 0.0, 1.0, 1.0); }
+    const uint32_t FRAGMENT[] = {
+        0x07230203, 0x00010000, 0x00000000, 12, 0x00000000,
+        0x00020011, 1,                                          //OpCapability Shader
+        0x0003000E, 0, 1,                                       //OpMemoryModel Logical GLSL450
+        0x0006000F, 4, 1, 0x6E69616D, 0x00000000, 2,            //OpEntryPoint Fragment %1 "main" %2
+        0x00030010, 1, 7,                                       //OpExecutionMode %1 OriginUpperLeft
+        0x00040047, 2, 30, 0,                                   //OpDecorate %2 Location 0
+        0x00020013, 3,                                          //%3 = OpTypeVoid
+        0x00030021, 4, 3,                                       //%4 = OpTypeFunction %3
+        0x00030016, 5, 32,                                      //%5 = OpTypeFloat 32
+        0x00040017, 6, 5, 4,                                    //%6 = OpTypeVector %5 4
+        0x00040020, 7, 3, 6,                                    //%7 = OpTypePointer Output %6
+        0x0004003B, 7, 2, 3,                                    //%2 = OpVariable %7 Output
+        0x0004002B, 5, 8, 0x00000000,                           //%8 = OpConstant %5 0.0
+        0x0004002B, 5, 9, 0x3F800000,                           //%9 = OpConstant %5 1.0
+        0x0007002C, 6, 10, 9, 8, 9, 9,                          //%10 = OpConstantComposite %6 %9 %8 %9 %9
+        0x00050036, 3, 1, 0, 4,                                 //%1 = OpFunction %3 None %4
+        0x000200F8, 11,                                         //%11 = OpLabel
+        0x0003003E, 2, 10,                                      //OpStore %2 %10
+        0x000100FD,                                             //OpReturn
+        0x00010038,                                             //OpFunctionEnd
+    };
+
+}
@@ -0,0 +1,174 @@
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <spdlog/spdlog.h>
+
+#include "base/vulkan_context.hpp"
+#include "base/frame_stats.hpp"
+#include "base/cpu_profiler.hpp"
+#include "benchmark_shaders.hpp"
+#include "scenarios.hpp"
+
+using namespace vk_sandbox;
+
+//frames run before measuring, so first use allocations and pipeline compiles stay out of the numbers.
+const uint32_t WARMUP_FRAMES = 8;
+
+struct ScenarioResult {
+    std::string name;
+    uint32_t count{};
+    uint32_t frames{};
+    double seconds{};
+    FrameMetricSummary cpu_frame{};
+    FrameMetricSummary gpu_frame{};
+};
+
+static ScenarioResult run_scenario(VulkanContext& context, BenchmarkScenario& scenario, const BenchmarkResources& resources,
+                                   uint32_t count, uint32_t frame_count) {
+    scenario.init(context, resources, count);
+
+    for (uint32_t i = 0; i < WARMUP_FRAMES; ++i) {
+        if (context.begin_frame(context.get_extent())) {
+            scenario.frame(context);
+            context.end_frame();
+        }
+    }
+
+    FrameStats stats{};
+    stats.init(frame_count, 0.0);
+
+    uint64_t begin = CpuProfiler::now();
+    uint64_t frame_begin = begin;
+    for (uint32_t i = 0; i < frame_count; ++i) {
+        if (context.begin_frame(context.get_extent())) {
+            scenario.frame(context);
+            context.end_frame();
+        }
+
+        uint64_t frame_end = CpuProfiler::now();
+        stats.add_sample(FrameMetric::cpu_frame, (frame_end - frame_begin) / 1e6);
+        frame_begin = frame_end;
+        double gpu_frame = context.get_gpu_milliseconds("frame");
+        if (gpu_frame > 0.0) {
+            stats.add_sample(FrameMetric::gpu_frame, gpu_frame);
+        }
+        stats.end_frame();
+    }
+
+    ScenarioResult result{};
+    result.name = scenario.get_name();
+    result.count = count;
+    result.frames = frame_count;
+    result.seconds = (CpuProfiler::now() - begin) / 1e9;
+    result.cpu_frame = stats.get_summary(FrameMetric::cpu_frame);
+    result.gpu_frame = stats.get_summary(FrameMetric::gpu_frame);
+
+    vkDeviceWaitIdle(context.get_device());
+    scenario.destroy(context);
+    return result;
+}
+
+static void write_summary(std::ofstream& file, const char* name, const FrameMetricSummary& summary) {
+    file << "\"" << name << "\": {\"avg\": " << summary.average << ", \"min\": " << summary.min
+         << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+         << ", \"max\": " << summary.max << "}";
+}
+
+static bool write_results(const std::string& path, const VulkanContext& context, const std::vector<ScenarioResult>& results) {
+    std::ofstream file(path);
+    if (!file) {
+        spdlog::error("[Benchmark] failed to open {} for writing", path);
+        return false;
+    }
+
+    const VkPhysicalDeviceProperties& properties = context.get_gpu_properties();
+    file << std::fixed << std::setprecision(4);
+    file << "{\n  \"device\": \"" << properties.deviceName << "\",\n";
+    file << "  \"api_version\": \"" << VK_VERSION_MAJOR(properties.apiVersion) << "." << VK_VERSION_MINOR(properties.apiVersion)
+         << "." << VK_VERSION_PATCH(properties.apiVersion) << "\",\n";
+    file << "  \"driver_version\": " << properties.driverVersion << ",\n";
+    file << "  \"frames_in_flight\": " << context.get_frames_in_flight() << ",\n";
+    file << "  \"scenarios\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ScenarioResult& result = results[i];
+        double fps = result.seconds > 0.0 ? result.frames / result.seconds : 0.0;
+        file << (i == 0 ? "" : ",") << "\n    {\"name\": \"" << result.name << "\", \"count\": " << result.count
+             << ", \"frames\": " << result.frames << ", \"seconds\": " << result.seconds << ", \"fps\": " << fps
+             << ", \"items_per_second\": " << fps * result.count << ",\n     ";
+        write_summary(file, "cpu_frame_ms", result.cpu_frame);
+        if (result.gpu_frame.sample_count != 0) {
+            file << ",\n     ";
+            write_summary(file, "gpu_frame_ms", result.gpu_frame);
+        }
+        file << "}";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+int main(int argc, char** argv) {
+    uint32_t frame_count = 500;
+    uint32_t count = 0;
+    std::string scenario_filter;
+    std::string output_path = "benchmark_results.json";
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frame_count = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            scenario_filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else {
+            spdlog::error("usage: {} [--frames N] [--count N] [--scenario name] [--output path]", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    //the benchmarks time themselves, the zone rings would only add noise.
+    CpuProfiler::set_enabled(false);
+
+    //no pipeline cache file, every run starts cold and equal.
+    VulkanContextSettings settings{};
+    settings.headless = true;
+    settings.pipeline_cache_path.clear();
+
+    VulkanContext context;
+    context.init_vulkan(settings);
+    context.create_headless({800, 600});
+
+    BenchmarkResources resources{};
+    resources.vertex_shader = context.create_shader_module(benchmark_shaders::VERTEX, sizeof(benchmark_shaders::VERTEX));
+    resources.fragment_shader = context.create_shader_module(benchmark_shaders::FRAGMENT, sizeof(benchmark_shaders::FRAGMENT));
+    VkPipelineLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    vkCreatePipelineLayout(context.get_device(), &layout_info, nullptr, &resources.pipeline_layout);
+
+    std::vector<ScenarioResult> results;
+    for (auto& scenario : create_benchmark_scenarios()) {
+        if (!scenario_filter.empty() && scenario_filter != scenario->get_name()) {
+            continue;
+        }
+        ScenarioResult result = run_scenario(context, *scenario, resources, count != 0 ? count : scenario->get_default_count(), frame_count);
+        spdlog::info("[Benchmark] {:<18} {:>6} items, {:.3f} ms/frame avg, p99 {:.3f} ms",
+                     result.name, result.count, result.cpu_frame.average, result.cpu_frame.p99);
+        results.push_back(result);
+    }
+
+    bool written = write_results(output_path, context, results);
+
+    context.destroy_deferred(resources.pipeline_layout);
+    context.destroy_shader_module(resources.vertex_shader);
+    context.destroy_shader_module(resources.fragment_shader);
+    context.destroy_vulkan();
+
+    if (results.empty()) {
+        spdlog::error("[Benchmark] no scenario named {}", scenario_filter);
+        return EXIT_FAILURE;
+    }
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,114 @@
+#include "microbench.hpp"
+#include "base/cpu_profiler.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+
+namespace vk_sandbox {
+
+    //calibration stops growing the iteration count here, so a slow benchmark still finishes
+    const uint64_t MAX_ITERATIONS = 1000000000;
+
+    struct RegisteredMicrobenchmark {
+        std::string name;
+        MicrobenchFunction function{};
+        int64_t argument{};
+        bool has_argument{false};
+    };
+
+    static std::vector<RegisteredMicrobenchmark>& get_registry() {
+        static std::vector<RegisteredMicrobenchmark> registry;
+        return registry;
+    }
+
+    bool register_microbenchmark(const char* name, MicrobenchFunction function, std::vector<int64_t> arguments) {
+        if (arguments.empty()) {
+            get_registry().push_back({name, function, 0, false});
+        }
+        for (auto argument : arguments) {
+            get_registry().push_back({name, function, argument, true});
+        }
+        return true;
+    }
+
+    bool MicrobenchState::keep_running() {
+        if (!started) {
+            started = true;
+            start_ns = CpuProfiler::now();
+        }
+        if (completed < iterations) {
+            completed++;
+            return true;
+        }
+        elapsed_ns += CpuProfiler::now() - start_ns;
+        return false;
+    }
+
+    void MicrobenchState::pause_timing() {
+        elapsed_ns += CpuProfiler::now() - start_ns;
+    }
+
+    void MicrobenchState::resume_timing() {
+        start_ns = CpuProfiler::now();
+    }
+
+    static MicrobenchState run_once(VulkanContext& context, const RegisteredMicrobenchmark& benchmark, uint64_t iterations) {
+        MicrobenchState state(context, benchmark.argument, iterations);
+        benchmark.function(state);
+        return state;
+    }
+
+    int run_microbenchmarks(VulkanContext& context, const MicrobenchOptions& options) {
+        int run_count = 0;
+        spdlog::info("[Microbench] {:<44} {:>12} {:>12} {:>12} {:>7} {:>12}", "benchmark", "mean ns", "median ns", "min ns", "cv", "items/s");
+
+        for (auto& benchmark : get_registry()) {
+            std::string name = benchmark.has_argument ? benchmark.name + "/" + std::to_string(benchmark.argument) : benchmark.name;
+            if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+                continue;
+            }
+
+            //grow the iteration count until a run takes the minimum time, extrapolating from the last one.
+            uint64_t iterations = 1;
+            MicrobenchState state = run_once(context, benchmark, iterations);
+            double min_ns = options.min_time * 1e9;
+            while (state.get_skip_reason().empty() && state.get_elapsed_ns() < min_ns && iterations < MAX_ITERATIONS) {
+                double scale = state.get_elapsed_ns() > 0 ? min_ns * 1.4 / state.get_elapsed_ns() : 10.0;
+                iterations = std::min(MAX_ITERATIONS, static_cast<uint64_t>(iterations * std::clamp(scale, 2.0, 10.0)));
+                state = run_once(context, benchmark, iterations);
+            }
+            if (!state.get_skip_reason().empty()) {
+                spdlog::info("[Microbench] {:<44} skipped: {}", name, state.get_skip_reason());
+                continue;
+            }
+
+            std::vector<double> samples;
+            for (uint32_t i = 0; i < options.repetitions; ++i) {
+                state = run_once(context, benchmark, iterations);
+                samples.push_back(static_cast<double>(state.get_elapsed_ns()) / iterations);
+            }
+            std::sort(samples.begin(), samples.end());
+
+            double mean = 0.0;
+            for (auto sample : samples) {
+                mean += sample;
+            }
+            mean /= samples.size();
+            double variance = 0.0;
+            for (auto sample : samples) {
+                variance += (sample - mean) * (sample - mean);
+            }
+            double stddev = samples.size() > 1 ? std::sqrt(variance / (samples.size() - 1)) : 0.0;
+            double median = samples.size() % 2 ? samples[samples.size() / 2]
+                                               : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2.0;
+            double items_per_second = state.get_items_per_iteration() * 1e9 / median;
+
+            //a coefficient of variation above a few percent means the numbers are noise, rerun on a quiet machine.
+            spdlog::info("[Microbench] {:<44} {:>12.1f} {:>12.1f} {:>12.1f} {:>6.1f}% {:>12.0f}",
+                         name, mean, median, samples.front(), mean > 0.0 ? stddev / mean * 100.0 : 0.0, items_per_second);
+            run_count++;
+        }
+        return run_count;
+    }
+
+}
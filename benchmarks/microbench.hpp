@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "base/vulkan_context.hpp"
+
+namespace vk_sandbox {
+
+    //in the spirit of Google Benchmark: the body loops on keep_running(), the harness picks the iteration count so a
+    //run lasts at least the minimum time and repeats runs to report the spread instead of a single number.
+    class MicrobenchState {
+    public:
+        MicrobenchState(VulkanContext& context, int64_t argument, uint64_t iterations)
+            : context(&context), argument(argument), iterations(iterations) {}
+
+        bool keep_running();
+        //setup inside the loop that shouldn't count
+        void pause_timing();
+        void resume_timing();
+
+        VulkanContext& get_context() { return *context; }
+        int64_t get_argument() const { return argument; }
+        //work items per iteration, reported as a rate next to the time
+        void set_items_per_iteration(int64_t items) { items_per_iteration = items; }
+        void skip(const std::string& reason) { skip_reason = reason; iterations = 0; }
+
+        uint64_t get_elapsed_ns() const { return elapsed_ns; }
+        int64_t get_items_per_iteration() const { return items_per_iteration; }
+        const std::string& get_skip_reason() const { return skip_reason; }
+    private:
+        VulkanContext* context{};
+        int64_t argument{};
+        uint64_t iterations{};
+        uint64_t completed{};
+        int64_t items_per_iteration{};
+        bool started{false};
+        uint64_t start_ns{};
+        uint64_t elapsed_ns{};
+        std::string skip_reason;
+    };
+
+    using MicrobenchFunction = void (*)(MicrobenchState&);
+
+    //registers function once per argument, once with 0 when there is none.
+    bool register_microbenchmark(const char* name, MicrobenchFunction function, std::vector<int64_t> arguments);
+
+    struct MicrobenchOptions {
+        std::string filter;
+        uint32_t repetitions{10};
+        double min_time{0.05};
+    };
+
+    //returns the number of benchmarks run
+    int run_microbenchmarks(VulkanContext& context, const MicrobenchOptions& options);
+
+    //keeps the compiler from dropping a computation whose result is otherwise unused
+    template<typename T>
+    inline void do_not_optimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+}
+
+#define MICROBENCHMARK(function, ...) \
+    static const bool function##_registered = ::vk_sandbox::register_microbenchmark(#function, function, {__VA_ARGS__})
@@ -0,0 +1,47 @@
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "base/vulkan_context.hpp"
+#include "base/cpu_profiler.hpp"
+#include "microbench.hpp"
+
+using namespace vk_sandbox;
+
+int main(int argc, char** argv) {
+    MicrobenchOptions options{};
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            options.repetitions = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.min_time = std::strtod(argv[++i], nullptr);
+        } else {
+            spdlog::error("usage: {} [--filter substring] [--repetitions N] [--min-time seconds]", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    CpuProfiler::set_enabled(false);
+
+    VulkanContextSettings settings{};
+    settings.headless = true;
+    settings.pipeline_cache_path.clear();
+
+    VulkanContext context;
+    context.init_vulkan(settings);
+    context.create_headless({800, 600});
+
+    int run_count = run_microbenchmarks(context, options);
+
+    context.destroy_vulkan();
+
+    if (run_count == 0) {
+        spdlog::error("[Microbench] no benchmark matches {}", options.filter);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
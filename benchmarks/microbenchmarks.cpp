@@ -0,0 +1,262 @@
+#include "microbench.hpp"
+#include "base/descriptor_allocator.hpp"
+
+namespace vk_sandbox {
+
+    static VkDescriptorSetLayout get_uniform_layout(VulkanContext& context) {
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        return context.get_descriptor_set_layout({binding});
+    }
+
+    static VkCommandPool create_command_pool(VulkanContext& context, VkCommandPoolCreateFlags flags) {
+        VkCommandPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        pool_info.queueFamilyIndex = context.get_graphics_queue_family();
+        pool_info.flags = flags;
+        VkCommandPool pool{};
+        vkCreateCommandPool(context.get_device(), &pool_info, nullptr, &pool);
+        return pool;
+    }
+
+    //descriptor pools
+
+    //argument sets allocated from the pool chain, then one reset
+    static void descriptor_allocate_reset(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        VkDescriptorSetLayout layout = get_uniform_layout(context);
+        DescriptorAllocator allocator{};
+        allocator.init(context.get_device());
+
+        while (state.keep_running()) {
+            for (int64_t i = 0; i < state.get_argument(); ++i) {
+                do_not_optimize(allocator.allocate(layout));
+            }
+            allocator.reset();
+        }
+        state.set_items_per_iteration(state.get_argument());
+        allocator.destroy();
+    }
+    MICROBENCHMARK(descriptor_allocate_reset, 1, 64, 1024);
+
+    static void descriptor_layout_cache_hit(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        while (state.keep_running()) {
+            do_not_optimize(get_uniform_layout(context));
+        }
+        state.set_items_per_iteration(1);
+    }
+    MICROBENCHMARK(descriptor_layout_cache_hit);
+
+    //VMA
+
+    //argument bytes, dedicated allocations past VMA's block size show up as a step
+    static void vma_buffer_create_destroy(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        buffer_info.size = state.get_argument();
+        buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        VmaAllocationCreateInfo allocation_info{};
+        allocation_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        while (state.keep_running()) {
+            VkBuffer buffer{};
+            VmaAllocation allocation{};
+            vmaCreateBuffer(context.get_allocator(), &buffer_info, &allocation_info, &buffer, &allocation, nullptr);
+            vmaDestroyBuffer(context.get_allocator(), buffer, allocation);
+        }
+        state.set_items_per_iteration(1);
+    }
+    MICROBENCHMARK(vma_buffer_create_destroy, 256, 64 * 1024, 64 * 1024 * 1024);
+
+    //argument live allocations freed in reverse, the pattern of per-frame scratch buffers.
+    //goes to VMA directly, destroy_buffer would only queue the frees behind frames that never come.
+    static void vma_buffer_batch(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        buffer_info.size = 4096;
+        buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        //matches VulkanBufferMemory::host_visible
+        VmaAllocationCreateInfo allocation_info{};
+        allocation_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+        allocation_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        std::vector<VkBuffer> buffers(state.get_argument());
+        std::vector<VmaAllocation> allocations(state.get_argument());
+
+        while (state.keep_running()) {
+            for (size_t i = 0; i < buffers.size(); ++i) {
+                vmaCreateBuffer(context.get_allocator(), &buffer_info, &allocation_info, &buffers[i], &allocations[i], nullptr);
+            }
+            for (size_t i = buffers.size(); i-- > 0;) {
+                vmaDestroyBuffer(context.get_allocator(), buffers[i], allocations[i]);
+            }
+        }
+        state.set_items_per_iteration(state.get_argument());
+    }
+    MICROBENCHMARK(vma_buffer_batch, 16, 256);
+
+    static void vma_image_create_destroy(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+        image_info.extent = {static_cast<uint32_t>(state.get_argument()), static_cast<uint32_t>(state.get_argument()), 1};
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        VmaAllocationCreateInfo allocation_info{};
+        allocation_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        while (state.keep_running()) {
+            VkImage image{};
+            VmaAllocation allocation{};
+            vmaCreateImage(context.get_allocator(), &image_info, &allocation_info, &image, &allocation, nullptr);
+            vmaDestroyImage(context.get_allocator(), image, allocation);
+        }
+        state.set_items_per_iteration(1);
+    }
+    MICROBENCHMARK(vma_image_create_destroy, 64, 1024);
+
+    //command buffers
+
+    //the frame pattern: reset the whole transient pool, then record into its buffer
+    static void command_pool_reset_begin_end(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        VkCommandPool pool = create_command_pool(context, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc_info.commandPool = pool;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandBufferCount = 1;
+        VkCommandBuffer cmd{};
+        vkAllocateCommandBuffers(context.get_device(), &alloc_info, &cmd);
+
+        VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        while (state.keep_running()) {
+            vkResetCommandPool(context.get_device(), pool, 0);
+            vkBeginCommandBuffer(cmd, &begin_info);
+            vkEndCommandBuffer(cmd);
+        }
+        state.set_items_per_iteration(1);
+        vkDestroyCommandPool(context.get_device(), pool, nullptr);
+    }
+    MICROBENCHMARK(command_pool_reset_begin_end);
+
+    //per buffer resets, what the frame loop avoids by resetting the pool
+    static void command_buffer_reset_begin_end(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        VkCommandPool pool = create_command_pool(context, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+        std::vector<VkCommandBuffer> command_buffers(state.get_argument());
+        VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc_info.commandPool = pool;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandBufferCount = command_buffers.size();
+        vkAllocateCommandBuffers(context.get_device(), &alloc_info, command_buffers.data());
+
+        VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        while (state.keep_running()) {
+            for (auto cmd : command_buffers) {
+                vkResetCommandBuffer(cmd, 0);
+                vkBeginCommandBuffer(cmd, &begin_info);
+                vkEndCommandBuffer(cmd);
+            }
+        }
+        state.set_items_per_iteration(state.get_argument());
+        vkDestroyCommandPool(context.get_device(), pool, nullptr);
+    }
+    MICROBENCHMARK(command_buffer_reset_begin_end, 1, 16);
+
+    static void command_buffer_allocate_free(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        VkCommandPool pool = create_command_pool(context, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        std::vector<VkCommandBuffer> command_buffers(state.get_argument());
+        VkCommandBufferAllocateInfo alloc_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc_info.commandPool = pool;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        alloc_info.commandBufferCount = command_buffers.size();
+
+        while (state.keep_running()) {
+            vkAllocateCommandBuffers(context.get_device(), &alloc_info, command_buffers.data());
+            vkFreeCommandBuffers(context.get_device(), pool, command_buffers.size(), command_buffers.data());
+        }
+        state.set_items_per_iteration(state.get_argument());
+        vkDestroyCommandPool(context.get_device(), pool, nullptr);
+    }
+    MICROBENCHMARK(command_buffer_allocate_free, 1, 64);
+
+    //sync objects
+
+    static void fence_create_destroy(MicrobenchState& state) {
+        VkDevice device = state.get_context().get_device();
+        VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        while (state.keep_running()) {
+            VkFence fence{};
+            vkCreateFence(device, &fence_info, nullptr, &fence);
+            vkDestroyFence(device, fence, nullptr);
+        }
+        state.set_items_per_iteration(1);
+    }
+    MICROBENCHMARK(fence_create_destroy);
+
+    //the per frame cost of reusing a fence instead of recreating it
+    static void fence_reset_status(MicrobenchState& state) {
+        VkDevice device = state.get_context().get_device();
+        VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        VkFence fence{};
+        vkCreateFence(device, &fence_info, nullptr, &fence);
+        while (state.keep_running()) {
+            vkResetFences(device, 1, &fence);
+            do_not_optimize(vkGetFenceStatus(device, fence));
+        }
+        state.set_items_per_iteration(1);
+        vkDestroyFence(device, fence, nullptr);
+    }
+    MICROBENCHMARK(fence_reset_status);
+
+    static void semaphore_create_destroy(MicrobenchState& state) {
+        VkDevice device = state.get_context().get_device();
+        VkSemaphoreCreateInfo semaphore_info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        while (state.keep_running()) {
+            VkSemaphore semaphore{};
+            vkCreateSemaphore(device, &semaphore_info, nullptr, &semaphore);
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+        state.set_items_per_iteration(1);
+    }
+    MICROBENCHMARK(semaphore_create_destroy);
+
+    //frame loop
+
+    //begin_frame to end_frame with nothing recorded: fence wait, pool resets, swapchain clear and submission.
+    static void frame_loop_empty(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        while (state.keep_running()) {
+            if (context.begin_frame(context.get_extent())) {
+                context.end_frame();
+            }
+        }
+        state.set_items_per_iteration(1);
+    }
+    MICROBENCHMARK(frame_loop_empty);
+
+    //the fan out cost of record_parallel with empty secondaries
+    static void frame_loop_record_parallel(MicrobenchState& state) {
+        VulkanContext& context = state.get_context();
+        uint32_t task_count = state.get_argument();
+        while (state.keep_running()) {
+            if (context.begin_frame(context.get_extent())) {
+                context.record_parallel(task_count, [](uint32_t, VkCommandBuffer) {});
+                context.end_frame();
+            }
+        }
+        state.set_items_per_iteration(1);
+    }
+    MICROBENCHMARK(frame_loop_record_parallel, 1, 4, 16);
+
+}
@@ -0,0 +1,161 @@
+#include "scenarios.hpp"
+
+namespace vk_sandbox {
+
+    //bytes per upload, small enough that staging and copy overhead dominates the bandwidth
+    const VkDeviceSize UPLOAD_SIZE = 4096;
+
+    static GraphicsPipelineDesc get_benchmark_pipeline_desc(VulkanContext& context, const BenchmarkResources& resources) {
+        return GraphicsPipelineBuilder()
+            .add_shader(VK_SHADER_STAGE_VERTEX_BIT, resources.vertex_shader)
+            .add_shader(VK_SHADER_STAGE_FRAGMENT_BIT, resources.fragment_shader)
+            .set_layout(resources.pipeline_layout)
+            .set_render_pass(context.get_render_pass())
+            .get_desc();
+    }
+
+    //the frame loop alone: fence wait, swapchain pass clear, submission.
+    class EmptyFrameScenario : public BenchmarkScenario {
+    public:
+        const char* get_name() const override { return "empty_frame"; }
+        uint32_t get_default_count() const override { return 0; }
+        void frame(VulkanContext&) override {}
+    };
+
+    class DrawScenario : public BenchmarkScenario {
+    public:
+        const char* get_name() const override { return "draws"; }
+        uint32_t get_default_count() const override { return 10000; }
+
+        void init(VulkanContext& context, const BenchmarkResources& resources, uint32_t count) override {
+            BenchmarkScenario::init(context, resources, count);
+            pipeline = context.get_graphics_pipeline(get_benchmark_pipeline_desc(context, resources));
+        }
+
+        void frame(VulkanContext& context) override {
+            VkCommandBuffer cmd = context.get_command_buffer();
+            for (uint32_t i = 0; i < count; ++i) {
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                vkCmdDraw(cmd, 3, 1, 0, i);
+            }
+        }
+    protected:
+        VkPipeline pipeline{};
+    };
+
+    //the same draws split over the recording threads in secondary command buffers.
+    class ParallelDrawScenario : public DrawScenario {
+    public:
+        const char* get_name() const override { return "draws_parallel"; }
+
+        void frame(VulkanContext& context) override {
+            uint32_t task_count = context.get_recording_thread_count();
+            uint32_t draws_per_task = (count + task_count - 1) / task_count;
+            context.record_parallel(task_count, [&](uint32_t task, VkCommandBuffer cmd) {
+                uint32_t end = std::min(count, (task + 1) * draws_per_task);
+                for (uint32_t i = task * draws_per_task; i < end; ++i) {
+                    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                    vkCmdDraw(cmd, 3, 1, 0, i);
+                }
+            });
+        }
+    };
+
+    class UploadScenario : public BenchmarkScenario {
+    public:
+        const char* get_name() const override { return "uploads"; }
+        uint32_t get_default_count() const override { return 256; }
+
+        void init(VulkanContext& context, const BenchmarkResources& resources, uint32_t count) override {
+            BenchmarkScenario::init(context, resources, count);
+            buffer = context.create_buffer(UPLOAD_SIZE * count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           VulkanBufferMemory::device_local);
+            data.resize(UPLOAD_SIZE, 0xab);
+        }
+
+        void frame(VulkanContext& context) override {
+            for (uint32_t i = 0; i < count; ++i) {
+                context.upload_buffer(buffer, data.data(), UPLOAD_SIZE, i * UPLOAD_SIZE);
+            }
+        }
+
+        void destroy(VulkanContext& context) override {
+            context.destroy_buffer(buffer);
+        }
+    private:
+        VulkanBuffer buffer{};
+        std::vector<uint8_t> data;
+    };
+
+    //a fresh frame set per item, written and bound like a per-draw uniform set.
+    class DescriptorChurnScenario : public BenchmarkScenario {
+    public:
+        const char* get_name() const override { return "descriptor_churn"; }
+        uint32_t get_default_count() const override { return 1000; }
+
+        void init(VulkanContext& context, const BenchmarkResources& resources, uint32_t count) override {
+            BenchmarkScenario::init(context, resources, count);
+            uniforms = context.create_buffer(256, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VulkanBufferMemory::host_visible);
+
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = 0;
+            binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            binding.descriptorCount = 1;
+            binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+            layout = context.get_descriptor_set_layout({binding});
+        }
+
+        void frame(VulkanContext& context) override {
+            VkDescriptorBufferInfo buffer_info{uniforms.buffer, 0, uniforms.size};
+            for (uint32_t i = 0; i < count; ++i) {
+                VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+                write.dstSet = context.allocate_frame_descriptor_set(layout);
+                write.dstBinding = 0;
+                write.descriptorCount = 1;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                write.pBufferInfo = &buffer_info;
+                vkUpdateDescriptorSets(context.get_device(), 1, &write, 0, nullptr);
+            }
+        }
+
+        void destroy(VulkanContext& context) override {
+            context.destroy_buffer(uniforms);
+        }
+    private:
+        VulkanBuffer uniforms{};
+        VkDescriptorSetLayout layout{};
+    };
+
+    //uncached compiles, what a pipeline cache miss costs the frame.
+    class PipelineCreationScenario : public BenchmarkScenario {
+    public:
+        const char* get_name() const override { return "pipeline_creation"; }
+        uint32_t get_default_count() const override { return 16; }
+
+        void init(VulkanContext& context, const BenchmarkResources& resources, uint32_t count) override {
+            BenchmarkScenario::init(context, resources, count);
+            desc = get_benchmark_pipeline_desc(context, resources);
+        }
+
+        void frame(VulkanContext& context) override {
+            for (uint32_t i = 0; i < count; ++i) {
+                VkPipeline pipeline = GraphicsPipelineBuilder::build(context.get_device(), VK_NULL_HANDLE, desc);
+                context.destroy_deferred(pipeline);
+            }
+        }
+    private:
+        GraphicsPipelineDesc desc{};
+    };
+
+    std::vector<std::unique_ptr<BenchmarkScenario>> create_benchmark_scenarios() {
+        std::vector<std::unique_ptr<BenchmarkScenario>> scenarios;
+        scenarios.push_back(std::make_unique<EmptyFrameScenario>());
+        scenarios.push_back(std::make_unique<DrawScenario>());
+        scenarios.push_back(std::make_unique<ParallelDrawScenario>());
+        scenarios.push_back(std::make_unique<UploadScenario>());
+        scenarios.push_back(std::make_unique<DescriptorChurnScenario>());
+        scenarios.push_back(std::make_unique<PipelineCreationScenario>());
+        return scenarios;
+    }
+
+}
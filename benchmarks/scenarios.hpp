@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "base/vulkan_context.hpp"
+
+namespace vk_sandbox {
+
+    //shared by every scenario, created once per run.
+    struct BenchmarkResources {
+        VkShaderModule vertex_shader{};
+        VkShaderModule fragment_shader{};
+        VkPipelineLayout pipeline_layout{};
+    };
+
+    //records count work items into every frame between begin_frame and end_frame.
+    class BenchmarkScenario {
+    public:
+        virtual ~BenchmarkScenario() = default;
+
+        virtual const char* get_name() const = 0;
+        //work items per frame when the command line doesn't set one
+        virtual uint32_t get_default_count() const = 0;
+        virtual void init(VulkanContext&, const BenchmarkResources&, uint32_t count) { this->count = count; }
+        virtual void frame(VulkanContext& context) = 0;
+        virtual void destroy(VulkanContext&) {}
+
+        uint32_t get_count() const { return count; }
+    protected:
+        uint32_t count{};
+    };
+
+    std::vector<std::unique_ptr<BenchmarkScenario>> create_benchmark_scenarios();
+
+}
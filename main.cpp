@@ -1,20 +1,47 @@
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
 #include "base/application.hpp"
 
 
 class SandboxApplication : public vk_sandbox::Application  {
 public:
-    SandboxApplication(const std::string& title) : Application(title) {}
+    SandboxApplication(const std::string& title, bool headless, uint64_t frame_limit) : Application(title, headless), frame_limit(frame_limit) {}
     void draw() override {
+        if (frame_limit != 0 && ++frame_count >= frame_limit) {
+            close();
+        }
     }
+private:
+    uint64_t frame_limit{0};
+    uint64_t frame_count{0};
 };
 
 
 
-int main() {
-    SandboxApplication application("sandbox");
+int main(int argc, char** argv) {
+    bool headless = false;
+    uint64_t frame_limit = 0;
+    const char* trace_path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frame_limit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        }
+    }
+
+    SandboxApplication application("sandbox", headless, frame_limit);
     application.init();
     application.destroy();
+
+    //chrome://tracing or ui.perfetto.dev, the last frames of every thread
+    if (trace_path != nullptr) {
+        vk_sandbox::CpuProfiler::write_chrome_trace(trace_path);
+    }
     return 0;
 }